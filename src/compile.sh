@@ -1,5 +1,5 @@
 #!/bin/bash
 
-gcc -std=c99 -o scg_modeler scg_main.c scg_modeler.c scg_assert.c naked_singles.c sudoku_rule.c hidden_singles.c locked_candidates.c
+gcc -std=c99 -o scg_modeler scg_main.c scg_modeler.c scg_assert.c naked_singles.c sudoku_rule.c hidden_singles.c locked_candidates.c scg_exec.c scg_cnf.c scg_sexp.c scg_smt2.c scg_timed.c scg_reach.c scg_aggregate.c scg_symmetry.c scg_final.c -pthread -lz
 
 
@@ -3,6 +3,7 @@
 #include "hidden_singles.h"
 #include "scg_modeler.h"
 #include "scg_assert.h"
+#include "scg_reach.h"
 
 // values of auxiliary parameter for Hidden Singles
 #define HS_ROW (0)
@@ -11,19 +12,22 @@
 #define HS_MIN HS_ROW
 #define HS_MAX HS_BLK
 
-static void fprint_cons_for_z_in_hidden_singles (FILE *out, data_t *data);
-static void fprint_literals_for_x_in_hidden_singles (FILE *out, const data_t *data);
+static void fprint_cons_for_z_in_hidden_singles (sink_t *out, data_t *data);
+static void fprint_literals_for_x_in_hidden_singles (sink_t *out, const data_t *data);
 static bool accepted_HS_version (const int *buf, const data_t *data);
+static void set_runarg_of_unit  (int unit, const data_t *data, runarg_t *runarg, testarg_t *testarg);
 
 void add_hidden_singles_strategy (data_t *data)
 {
         param_t *p = data->p;
 
-        const int pid_HS = add_param(HS_MIN, HS_MAX, tag_HS, p);
+        const int max = (data->fused ? HS_MIN: HS_MAX); // fused variables have only the first unit.
+
+        const int pid_HS = add_param(HS_MIN, max, tag_HS, p);
         assert(pid_HS >= 0);
 
         int nvars = count_combinations_of_IJNK_values(p);
-        nvars = nvars * (HS_MAX - HS_MIN + 1);
+        nvars = nvars * (max - HS_MIN + 1);
         // NOTE: for simplicity, the strategy requests more variables than needed.
 	// The function accepted() decides whether variables really appear in constraints.
 
@@ -51,17 +55,15 @@ void add_hidden_singles_strategy (data_t *data)
 // Hidden Single (column): none of the cells except (i,j) in the same column has n as a candidate in step k-1.
 // Hidden Single (block) : none of the cells except (i,j) in the same block  has n as a candidate in step k-1.
 //
-static void fprint_cons_for_z_in_hidden_singles (FILE *out, data_t *data)
+// If fused, a single variable per (i,j,n,k) is defined by the disjunction of all of them.
+//
+static void fprint_cons_for_z_in_hidden_singles (sink_t *out, data_t *data)
 {
-        fprintf(out, ";\n");
-        fprintf(out, "; Constraints for Hidden Singles\n");
+        sink_puts(out, ";\n");
+        sink_puts(out, "; Constraints for Hidden Singles\n");
 
         param_t *p = data->p;
 
-        const int rank = data->rank;
-        const int pid_I = data->pid_I;
-        const int pid_J = data->pid_J;
-        const int pid_N = data->pid_N;
         const int pid_K = data->pid_K;
 
         const idmgr_t *mgr = get_idmgr(tag_HS, data);
@@ -79,57 +81,8 @@ static void fprint_cons_for_z_in_hidden_singles (FILE *out, data_t *data)
         for(reset_param(p); p->end == false; next_param(p)) {
                 if (p->cur[pid_K] == p->min[pid_K])     continue;
 
-                runarg_t runarg;
-                testarg_t testarg;
-
-                switch (p->cur[pid_HS]) {
-                        case HS_ROW:
-                                set_testarg(&testarg, p->cur[pid_I], p->cur[pid_J], -1, -1, rank);
-                                set_runarg(&runarg,
-                                        p->cur[pid_I],
-                                        -1,
-                                        p->cur[pid_N],
-                                        -1,
-                                        p->cur[pid_K] - 1,
-                                        'r', 'y',
-                                        test_not_equal_cell, &testarg);
-                                break;
-
-                        case HS_COL:
-                                set_testarg(&testarg, p->cur[pid_I], p->cur[pid_J], -1, -1, rank);
-                                set_runarg(&runarg,
-                                        -1,
-                                        p->cur[pid_J],
-                                        p->cur[pid_N],
-                                        -1,
-                                        p->cur[pid_K] - 1,
-                                        'c', 'y',
-                                        test_not_equal_cell, &testarg);
-                                break;
-
-                        case HS_BLK:
-                                {
-                                set_testarg(&testarg, p->cur[pid_I], p->cur[pid_J], -1, -1, rank);
-
-                                cell_t q = cell_at(p->cur[pid_I], p->cur[pid_J], rank);
-                                const int group_B = ownerblock(q, rank);
-
-                                set_runarg(&runarg,
-                                        -1,
-                                        -1,
-                                        p->cur[pid_N],
-                                        group_B,
-                                        p->cur[pid_K] - 1,
-                                        'b', 'y',
-                                        test_not_equal_cell, &testarg);
-                                }
-                                break;
-
-                        default:
-                                assert(0);
-                                exit(EXIT_FAILURE);
-
-                }
+                runarg_t  runarg[HS_MAX - HS_MIN + 1];
+                testarg_t testarg[HS_MAX - HS_MIN + 1];
 
                 read_cur(p, buf, mgr);
 
@@ -138,9 +91,15 @@ static void fprint_cons_for_z_in_hidden_singles (FILE *out, data_t *data)
                         mgr->encoder(buf, &index, data->rank, p, mgr);
                         assert_variable_index(index, mgr);
 
-                        fprintf(out, "(iff  z_%d ", index);
-                        fprint_term(out, p, &runarg);
-                        fprintf(out, " )\n");
+                        if (data->fused) {
+                                for (int unit = HS_MIN; unit <= HS_MAX; unit++) {
+                                        set_runarg_of_unit(unit, data, &runarg[unit - HS_MIN], &testarg[unit - HS_MIN]);
+                                }
+                                fprint_definition_by_terms(out, data, index, runarg, HS_MAX - HS_MIN + 1);
+                        } else {
+                                set_runarg_of_unit(p->cur[pid_HS], data, &runarg[0], &testarg[0]);
+                                fprint_definition_by_term(out, data, index, &runarg[0]);
+                        }
                 }
         }
 
@@ -148,7 +107,7 @@ static void fprint_cons_for_z_in_hidden_singles (FILE *out, data_t *data)
 
 // Note: this function is supposed to be called within parameter loop.
 // In order not to change parameter values, declare const for param_t*.
-static void fprint_literals_for_x_in_hidden_singles (FILE *out, const data_t *data)
+static void fprint_literals_for_x_in_hidden_singles (sink_t *out, const data_t *data)
 {
         const param_t *p = data->p;
         assert_IJNK_active(p);
@@ -181,7 +140,7 @@ static void fprint_literals_for_x_in_hidden_singles (FILE *out, const data_t *da
                         mgr->encoder(buf, &index, data->rank, p, mgr);
                         assert_variable_index(index, mgr);
 
-                        fprintf(out, " z_%d ", index);
+                        fprint_z_literal(out, index);
                 }
         }
 
@@ -218,7 +177,69 @@ static bool accepted_HS_version (const int *buf, const data_t *data)
         assert(0 <= pos_K);
 
         if (buf[pos_K] == p->min[pid_K]) return false;
+        if (false == applies_in_step(data, tag_HS, buf[pos_K])) return false;
+        if (false == reachable(buf, mgr, data, true)) return false;
 
         return accepted_general(buf, mgr, data);
 }
 
+// Set the run of Y literals of the unit (HS_ROW, HS_COL, or HS_BLK) for the current (i,j,n,k).
+static void set_runarg_of_unit (int unit, const data_t *data, runarg_t *runarg, testarg_t *testarg)
+{
+        const param_t *p = data->p;
+
+        const int rank  = data->rank;
+        const int pid_I = data->pid_I;
+        const int pid_J = data->pid_J;
+        const int pid_N = data->pid_N;
+        const int pid_K = data->pid_K;
+
+        switch (unit) {
+                case HS_ROW:
+                        set_testarg(testarg, p->cur[pid_I], p->cur[pid_J], -1, -1, rank);
+                        set_runarg(runarg,
+                                p->cur[pid_I],
+                                -1,
+                                p->cur[pid_N],
+                                -1,
+                                p->cur[pid_K] - 1,
+                                'r', 'y',
+                                test_not_equal_cell, testarg);
+                        break;
+
+                case HS_COL:
+                        set_testarg(testarg, p->cur[pid_I], p->cur[pid_J], -1, -1, rank);
+                        set_runarg(runarg,
+                                -1,
+                                p->cur[pid_J],
+                                p->cur[pid_N],
+                                -1,
+                                p->cur[pid_K] - 1,
+                                'c', 'y',
+                                test_not_equal_cell, testarg);
+                        break;
+
+                case HS_BLK:
+                        {
+                        set_testarg(testarg, p->cur[pid_I], p->cur[pid_J], -1, -1, rank);
+
+                        cell_t q = cell_at(p->cur[pid_I], p->cur[pid_J], rank);
+                        const int group_B = ownerblock(q, rank);
+
+                        set_runarg(runarg,
+                                -1,
+                                -1,
+                                p->cur[pid_N],
+                                group_B,
+                                p->cur[pid_K] - 1,
+                                'b', 'y',
+                                test_not_equal_cell, testarg);
+                        }
+                        break;
+
+                default:
+                        assert(0);
+                        exit(EXIT_FAILURE);
+
+        }
+}
@@ -2,6 +2,7 @@
 
 #include "locked_candidates.h"
 #include "scg_assert.h"
+#include "scg_reach.h"
 
 // values of axuliary parameter (group types of A and B) for Locked Candidates strategy
 #define LC_ARBB TYPE_ARBB  // A: Row    B: Block
@@ -11,8 +12,8 @@
 #define LC_MIN LC_ARBB
 #define LC_MAX LC_ABBC
 
-static void fprint_cons_for_z_in_locked_candidates (FILE *out, data_t *data);
-static void fprint_literals_for_y_in_locked_candidates (FILE *out, const data_t *data);
+static void fprint_cons_for_z_in_locked_candidates (sink_t *out, data_t *data);
+static void fprint_literals_for_y_in_locked_candidates (sink_t *out, const data_t *data);
 static bool accepted_LC_version (const int *buf, const data_t *data);
 static void set_index_for_NKLC123 (
         int index_N, int index_K, int index_LC_A, int index_LC_B, int index_LC_T,
@@ -62,10 +63,10 @@ void add_locked_candidates_strategy (data_t *data)
 }
 
 // Print out constraints for Locked Candidates strategy.
-static void fprint_cons_for_z_in_locked_candidates (FILE *out, data_t *data)
+static void fprint_cons_for_z_in_locked_candidates (sink_t *out, data_t *data)
 {
-        fprintf(out, ";\n");
-        fprintf(out, "; Constraints for Locked Candidates\n");
+        sink_puts(out, ";\n");
+        sink_puts(out, "; Constraints for Locked Candidates\n");
 
         param_t *p = data->p;
 
@@ -178,9 +179,7 @@ static void fprint_cons_for_z_in_locked_candidates (FILE *out, data_t *data)
                         mgr->encoder(buf, &index, rank, p, mgr);
                         assert_variable_index(index, mgr);
 
-                        fprintf(out, "(iff z_%d ", index);
-                        fprint_term(out, p, &runarg);
-                        fprintf(out, " )\n");
+                        fprint_definition_by_term(out, data, index, &runarg);
                 }
         }
 
@@ -188,7 +187,7 @@ static void fprint_cons_for_z_in_locked_candidates (FILE *out, data_t *data)
 
 // Note: this function is supposed to be called within parameter loop.
 // In order not to change parameter values, declare const for param_t*.
-static void fprint_literals_for_y_in_locked_candidates (FILE *out, const data_t *data)
+static void fprint_literals_for_y_in_locked_candidates (sink_t *out, const data_t *data)
 {
         const param_t *p = data->p;
         assert_IJNK_active(p);
@@ -249,7 +248,7 @@ static void fprint_literals_for_y_in_locked_candidates (FILE *out, const data_t
                                 mgr->encoder(buf, &index, data->rank, p, mgr);
                                 assert_variable_index(index, mgr);
 
-                                fprintf(out, " z_%d ", index);
+                                fprint_z_literal(out, index);
                         }
                 }
         }
@@ -278,7 +277,7 @@ static void fprint_literals_for_y_in_locked_candidates (FILE *out, const data_t
                                 mgr->encoder(buf, &index, data->rank, p, mgr);
                                 assert_variable_index(index, mgr);
 
-                                fprintf(out, " z_%d ", index);
+                                fprint_z_literal(out, index);
                         }
                 }
         }
@@ -307,7 +306,7 @@ static void fprint_literals_for_y_in_locked_candidates (FILE *out, const data_t
                                 mgr->encoder(buf, &index, data->rank, p, mgr);
                                 assert_variable_index(index, mgr);
 
-                                fprintf(out, " z_%d ", index);
+                                fprint_z_literal(out, index);
                         }
                 }
         }
@@ -337,7 +336,7 @@ static void fprint_literals_for_y_in_locked_candidates (FILE *out, const data_t
                                 mgr->encoder(buf, &index, data->rank, p, mgr);
                                 assert_variable_index(index, mgr);
 
-                                fprintf(out, " z_%d ", index);
+                                fprint_z_literal(out, index);
                         }
                 }
         }
@@ -364,7 +363,7 @@ static bool accepted_LC_version (const int *buf, const data_t *data)
         assert(0 <= pos_K);
 
         if (buf[pid_K] == p->min[pid_K]) return false;
-
+        if (false == applies_in_step(data, tag_LC, buf[pos_K])) return false;
 
         if (false == accepted_general(buf, mgr, data)) {
                 return false;
@@ -382,11 +381,16 @@ static bool accepted_LC_version (const int *buf, const data_t *data)
         assert(pos_LC_B >= 0);
         assert(pos_LC_T >= 0);
 
-        return have_common_cell(
+        if (false == have_common_cell(
                         buf[pos_LC_A],
                         buf[pos_LC_B],
                         buf[pos_LC_T],
-                        data->rank);
+                        data->rank)) {
+                return false;
+        }
+
+        // n cannot be eliminated in all cells of B but not in A yet.
+        return buf[pos_K] >= first_locked(data, buf[pos_LC_T], buf[pos_LC_A], buf[pos_LC_B]);
 }
 
 
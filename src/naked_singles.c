@@ -2,9 +2,10 @@
 
 #include "naked_singles.h"
 #include "scg_assert.h"
+#include "scg_reach.h"
 
-static void fprint_cons_for_z_in_naked_singles (FILE *out, data_t *data);
-static void fprint_literals_for_x_in_naked_singles (FILE *out, const data_t *data);
+static void fprint_cons_for_z_in_naked_singles (sink_t *out, data_t *data);
+static void fprint_literals_for_x_in_naked_singles (sink_t *out, const data_t *data);
 static bool accepted_NS_version (const int *buf, const data_t *data);
 
 void add_naked_singles_strategy (data_t *data)
@@ -40,10 +41,10 @@ void add_naked_singles_strategy (data_t *data)
 // this is not necessary because otherwise, contradiction follows 
 // from the condition and sudoku rule.
 //
-static void fprint_cons_for_z_in_naked_singles (FILE *out, data_t *data)
+static void fprint_cons_for_z_in_naked_singles (sink_t *out, data_t *data)
 {
-        fprintf(out, ";\n");
-        fprintf(out, "; Constraints for Naked Singles\n");
+        sink_puts(out, ";\n");
+        sink_puts(out, "; Constraints for Naked Singles\n");
 
         param_t *p = data->p;
 
@@ -86,9 +87,7 @@ static void fprint_cons_for_z_in_naked_singles (FILE *out, data_t *data)
                         mgr->encoder(buf, &index, rank, p, mgr);
                         assert_variable_index(index, mgr);
 
-                        fprintf(out, "(iff  z_%d ", index);
-                        fprint_term (out, p, &runarg);
-                        fprintf(out, " )\n");
+                        fprint_definition_by_term(out, data, index, &runarg);
                 }
         }
 
@@ -96,7 +95,7 @@ static void fprint_cons_for_z_in_naked_singles (FILE *out, data_t *data)
 
 // Note: this function is supposed to be called within parameter loop.
 // In order not to change parameter values, declare const for param_t*.
-static void fprint_literals_for_x_in_naked_singles (FILE *out, const data_t *data)
+static void fprint_literals_for_x_in_naked_singles (sink_t *out, const data_t *data)
 {
         const param_t *p = data->p;
         assert_IJNK_active(p);
@@ -118,7 +117,7 @@ static void fprint_literals_for_x_in_naked_singles (FILE *out, const data_t *dat
                 mgr->encoder(buf, &index, data->rank, p, mgr);
                 assert_variable_index(index, mgr);
 
-                fprintf(out, " z_%d ", index);
+                fprint_z_literal(out, index);
         }
 }
 
@@ -142,6 +141,8 @@ static bool accepted_NS_version (const int *buf, const data_t *data)
         assert(0 <= pos_K);
 
         if (buf[pos_K] == p->min[pid_K]) return false; // no naked single strategy for the initial step.
+        if (false == applies_in_step(data, tag_NS, buf[pos_K])) return false;
+        if (false == reachable(buf, mgr, data, true)) return false;
 
         return accepted_general(buf, mgr, data);
 }
@@ -0,0 +1,319 @@
+#include <assert.h>
+#include <string.h>
+
+#include "scg_aggregate.h"
+#include "scg_assert.h"
+
+// values of auxiliary parameter (kinds of aggregates)
+#define AG_X_PRE (0) // (or  lit_0 ... lit_t) of X literals
+#define AG_X_SUF (1) // (or  lit_t ... lit_last) of X literals
+#define AG_Y_PRE (2) // (and lit_0 ... lit_t) of Y literals
+#define AG_Y_SUF (3) // (and lit_t ... lit_last) of Y literals
+#define AG_MIN AG_X_PRE
+#define AG_MAX AG_Y_SUF
+
+static void fprint_cons_for_z_in_aggregates (sink_t *out, data_t *data);
+static bool accepted_AG_version (const int *buf, const data_t *data);
+static void fprint_operand      (sink_t *out, const data_t *data, int kind, int unit, int t, int n, int k);
+static bool shared              (const data_t *data, int unit, bool y, int k);
+static void position_in_unit    (const data_t *data, const runarg_t *arg, int *unit, int *t);
+static cell_t cell_of_unit      (int unit, int t, int rank);
+
+// A unit u is the row u, the column u - size, or the block u - 2*size,
+// and its t-th cell is that in the order of collect_literals().
+void add_aggregate_variables (data_t *data)
+{
+        param_t *p = data->p;
+
+        const int pid_AG_U = add_param(0, 3 * data->size - 1, tag_AG_U, p);
+        const int pid_AG_T = add_param(0, data->size - 1,     tag_AG_T, p);
+        const int pid_AG_D = add_param(AG_MIN, AG_MAX,        tag_AG_D, p);
+
+        assert(pid_AG_U >= 0);
+        assert(pid_AG_T >= 0);
+        assert(pid_AG_D >= 0);
+
+        const int pid_N = data->pid_N;
+        const int pid_K = data->pid_K;
+
+        int nvars = 1;
+        for (int pid = 0; pid < p->npars; pid++) {
+                if (pid == pid_N    || pid == pid_K
+                ||  pid == pid_AG_U || pid == pid_AG_T || pid == pid_AG_D) {
+                        nvars = nvars * (p->max[pid] - p->min[pid] + 1);
+                }
+        }
+        // NOTE: for simplicity, more variables are requested than needed.
+        // The function accepted() decides whether variables really appear in constraints.
+
+        const int len = 5;
+
+        assert(len == 5);
+        int buf[len];
+        buf[0] = pid_N;
+        buf[1] = pid_K;
+        buf[2] = pid_AG_U;
+        buf[3] = pid_AG_T;
+        buf[4] = pid_AG_D;
+        add_strategy(data, tag_AG, nvars, buf, len,
+                        default_encoder,
+                        default_decoder,
+                        accepted_AG_version,
+                        NULL,
+                        NULL,
+                        fprint_cons_for_z_in_aggregates);
+}
+
+// Whether the formula of arg over all cells of a unit but one is printed by aggregates,
+// where the connective must be "or" for X literals, and "and" for Y literals.
+bool is_all_but_one (const data_t *data, const runarg_t *arg, const char *connective)
+{
+        if (get_idmgr(tag_AG, data) == NULL) return false;
+
+        if (arg->test != test_not_equal_cell) return false;
+        if (arg->type != 'r' && arg->type != 'c' && arg->type != 'b') return false;
+
+        if (arg->symb == 'x' && strcmp(connective, "or")  != 0) return false;
+        if (arg->symb == 'y' && strcmp(connective, "and") != 0) return false;
+        if (arg->symb == 'y' && get_idmgr(tag_HS, data) == NULL) return false;
+
+        int unit, t;
+        position_in_unit(data, arg, &unit, &t);
+
+        return shared(data, unit, arg->symb == 'y', arg->fixed_K);
+}
+
+// Print out (or prefix suffix) for X literals, or (and prefix suffix) for Y literals,
+// where prefix and suffix are the aggregates before and after the cell excluded by arg.
+// Either of them is omitted for the first and last cells of the unit.
+void fprint_all_but_one (sink_t *out, const data_t *data, const runarg_t *arg)
+{
+        sink_puts(out, arg->symb == 'x' ? "(or ": "(and ");
+        fprint_operands_of_all_but_one(out, data, arg);
+        sink_puts(out, " )\n");
+}
+
+// Print out the prefix and suffix of fprint_all_but_one() without the connective,
+// e.g., to join them into a larger disjunction.
+void fprint_operands_of_all_but_one (sink_t *out, const data_t *data, const runarg_t *arg)
+{
+        const int size = data->size;
+
+        int unit, t;
+        position_in_unit(data, arg, &unit, &t);
+
+        const bool x = (arg->symb == 'x');
+
+        if (t > 0) {
+                fprint_operand(out, data, x ? AG_X_PRE: AG_Y_PRE, unit, t - 1, arg->fixed_N, arg->fixed_K);
+        }
+        if (t < size - 1) {
+                fprint_operand(out, data, x ? AG_X_SUF: AG_Y_SUF, unit, t + 1, arg->fixed_N, arg->fixed_K);
+        }
+}
+
+// Print out constraints for aggregates:
+// the prefix up to the t-th cell is (op prefix_(t-1) lit_t), and the suffix from it (op lit_t suffix_(t+1)).
+static void fprint_cons_for_z_in_aggregates (sink_t *out, data_t *data)
+{
+        sink_puts(out, ";\n");
+        sink_puts(out, "; Constraints for Aggregates\n");
+
+        param_t *p = data->p;
+
+        const int rank  = data->rank;
+        const int pid_N = data->pid_N;
+        const int pid_K = data->pid_K;
+
+        const idmgr_t *mgr = get_idmgr(tag_AG, data);
+        assert(mgr != NULL);
+
+        const int pid_AG_U = get_param(tag_AG_U, p);
+        const int pid_AG_T = get_param(tag_AG_T, p);
+        const int pid_AG_D = get_param(tag_AG_D, p);
+
+        assert(mgr->len == 5);
+        int buf[5];
+
+        make_all_inactive(p);
+        make_assoc_active(p, mgr);
+
+        for(reset_param(p); p->end == false; next_param(p)) {
+                read_cur(p, buf, mgr);
+
+                if (false == mgr->accepted(buf, data)) continue;
+
+                int index;
+                mgr->encoder(buf, &index, rank, p, mgr);
+                assert_variable_index(index, mgr);
+
+                const int  n    = p->cur[pid_N];
+                const int  k    = p->cur[pid_K];
+                const int  unit = p->cur[pid_AG_U];
+                const int  t    = p->cur[pid_AG_T];
+                const int  kind = p->cur[pid_AG_D];
+                const bool pre  = (kind == AG_X_PRE || kind == AG_Y_PRE);
+                const char symb = (kind == AG_X_PRE || kind == AG_X_SUF) ? 'x': 'y';
+
+                const cell_t q = cell_of_unit(unit, t, rank);
+
+                sink_puts(out, "(iff ");
+                fprint_z_literal(out, index);
+                sink_puts(out, symb == 'x' ? "(or ": "(and ");
+                if (pre) fprint_operand(out, data, kind, unit, t - 1, n, k);
+                fprint_literal(out, symb, q.I, q.J, n, k);
+                if (false == pre) fprint_operand(out, data, kind, unit, t + 1, n, k);
+                sink_endexpr(out, ") )\n");
+        }
+}
+
+// Print out the aggregate of the kind up to, or from, the t-th cell of the unit,
+// which is the literal of the cell itself at the end of the unit.
+static void fprint_operand (sink_t *out, const data_t *data, int kind, int unit, int t, int n, int k)
+{
+        const int size = data->size;
+        const int rank = data->rank;
+
+        const bool pre  = (kind == AG_X_PRE || kind == AG_Y_PRE);
+        const char symb = (kind == AG_X_PRE || kind == AG_X_SUF) ? 'x': 'y';
+
+        if ((pre && t == 0) || (false == pre && t == size - 1)) {
+                const cell_t q = cell_of_unit(unit, t, rank);
+                fprint_literal(out, symb, q.I, q.J, n, k);
+                return;
+        }
+
+        const idmgr_t *mgr = get_idmgr(tag_AG, data);
+        assert(mgr != NULL);
+
+        int buf[5];
+        assert(mgr->len == 5);
+        for (int pos = 0; pos < mgr->len; pos++) {
+                const int pid = mgr->pid[pos];
+                if      (pid == data->pid_N)                 buf[pos] = n;
+                else if (pid == data->pid_K)                 buf[pos] = k;
+                else if (pid == get_param(tag_AG_U, data->p)) buf[pos] = unit;
+                else if (pid == get_param(tag_AG_T, data->p)) buf[pos] = t;
+                else                                         buf[pos] = kind;
+        }
+        assert(mgr->accepted(buf, data));
+
+        int index;
+        mgr->encoder(buf, &index, rank, data->p, mgr);
+        assert_variable_index(index, mgr);
+
+        fprint_z_literal(out, index);
+}
+
+// This function determines whether the combination of parameter values,
+// held by the array buf, is accepted or not.
+// Aggregates are needed from the second cell to the second last one,
+// and those of Y literals only for Hidden Singles, which uses them in the next step,
+// and of X literals only for the Sudoku rule, in the steps to which it is applied (see applies_in_step()).
+// Besides, a prefix is needed only if some cell after it is a non-clue cell, and a suffix before it,
+// except in step 0, where the Sudoku rule is applied to all cells (see accepted_general()).
+static bool accepted_AG_version (const int *buf, const data_t *data)
+{
+        const param_t *p = data->p;
+
+        const idmgr_t *mgr = get_idmgr(tag_AG, data);
+        assert(mgr != NULL);
+
+        const int pos_K    = pos_of_pid(data->pid_K, mgr);
+        const int pos_AG_U = pos_of_pid(get_param(tag_AG_U, p), mgr);
+        const int pos_AG_T = pos_of_pid(get_param(tag_AG_T, p), mgr);
+        const int pos_AG_D = pos_of_pid(get_param(tag_AG_D, p), mgr);
+
+        assert(pos_K    >= 0);
+        assert(pos_AG_U >= 0);
+        assert(pos_AG_T >= 0);
+        assert(pos_AG_D >= 0);
+
+        const int t    = buf[pos_AG_T];
+        const int kind = buf[pos_AG_D];
+
+        if (t == 0 || t == data->size - 1) return false;
+
+        if (kind == AG_Y_PRE || kind == AG_Y_SUF) {
+                if (get_idmgr(tag_HS, data) == NULL)   return false;
+                if (buf[pos_K] == p->max[data->pid_K]) return false;
+                if (false == applies_in_step(data, tag_HS, buf[pos_K] + 1)) return false;
+        }
+        if (kind == AG_X_PRE || kind == AG_X_SUF) {
+                if (false == applies_in_step(data, tag_SR, buf[pos_K])) return false;
+        }
+
+        const bool pre = (kind == AG_X_PRE || kind == AG_Y_PRE);
+        const bool y   = (kind == AG_Y_PRE || kind == AG_Y_SUF);
+
+        // Unlike accepted_general(), this depends on clues even while Z variables are numbered (see renumber_ids()),
+        // which is safe because aggregates are never used with skeletons.
+        if (false == shared(data, buf[pos_AG_U], y, buf[pos_K])) return false;
+        if (false == y && buf[pos_K] == p->min[data->pid_K])      return true;
+
+        for (int s = (pre ? t + 1: 0); s < (pre ? data->size: t); s++) {
+                const cell_t q = cell_of_unit(buf[pos_AG_U], s, data->rank);
+                if (false == is_clue_cell(q, data->cs, data->nclues)) return true;
+        }
+
+        return false;
+}
+
+// Whether the formulas over the unit for the literals of y (or x) in step k are printed by aggregates.
+// They are so if they are cheaper in CNF: for m formulas, 3 clauses for each of the 2*(size-2) aggregates
+// and the m definitions of two operands, against size clauses for each definition of size-1 literals.
+// In step 0, the Sudoku rule is applied to all cells, and otherwise only non-clue cells are concerned.
+static bool shared (const data_t *data, int unit, bool y, int k)
+{
+        const int size = data->size;
+
+        int m = size;
+        if (y || k > data->p->min[data->pid_K]) {
+                m = 0;
+                for (int t = 0; t < size; t++) {
+                        if (false == is_clue_cell(cell_of_unit(unit, t, data->rank), data->cs, data->nclues)) m++;
+                }
+        }
+
+        return 3 * 2 * (size - 2) + 3 * m < size * m;
+}
+
+// Get the unit of the run of arg, and the position of the cell excluded from it.
+static void position_in_unit (const data_t *data, const runarg_t *arg, int *unit, int *t)
+{
+        const int size = data->size;
+        const int rank = data->rank;
+
+        const int I = arg->testarg->I;
+        const int J = arg->testarg->J;
+
+        switch (arg->type) {
+                case 'r':
+                        *unit = arg->fixed_I;
+                        *t    = J;
+                        break;
+                case 'c':
+                        *unit = size + arg->fixed_J;
+                        *t    = I;
+                        break;
+                case 'b':
+                        *unit = 2 * size + arg->fixed_B;
+                        *t    = (I % rank) * rank + (J % rank);
+                        break;
+                default:
+                        assert(0);
+                        exit(EXIT_FAILURE);
+        }
+        assert(equal_cell(cell_of_unit(*unit, *t, rank), cell_at(I, J, rank)));
+}
+
+static cell_t cell_of_unit (int unit, int t, int rank)
+{
+        const int size = rank * rank;
+
+        switch (unit / size) {
+                case 0:  return cell_at(unit, t, rank);
+                case 1:  return cell_at(t, unit - size, rank);
+                default: return cell_in_block(t, unit - 2 * size, rank);
+        }
+}
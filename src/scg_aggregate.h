@@ -0,0 +1,19 @@
+#ifndef SCG_AGGREGATE_H
+#define SCG_AGGREGATE_H
+
+#include "scg_modeler.h"
+
+// Shared prefix and suffix aggregates of the literals of a unit (row, column, or block) for a number and a step,
+// by which a formula over all cells of the unit but one is printed as that of two operands:
+// the prefix before the cell and the suffix after it.
+// Aggregates of X literals are disjunctions for the Sudoku rule,
+// and those of Y literals are conjunctions for Hidden Singles, so that they must be added after all strategies.
+// Then the literals of each unit, number, and step are printed O(size) times, instead of O(size^2) times,
+// which pays for units with many non-clue cells, to which aggregates are limited.
+extern void add_aggregate_variables (data_t *data);
+
+extern bool is_all_but_one      (const data_t *data, const runarg_t *arg, const char *connective);
+extern void fprint_all_but_one  (sink_t *out, const data_t *data, const runarg_t *arg);
+extern void fprint_operands_of_all_but_one (sink_t *out, const data_t *data, const runarg_t *arg);
+
+#endif /*SCG_AGGREGATE_H*/
@@ -47,11 +47,13 @@ void assert_encoder_decoder(idmgr_t *mgr, data_t *data)
                 exit(EXIT_FAILURE);
         }
 
-        // check whether the encoder is one-to-one
+        // check whether the encoder is one-to-one on accepted combinations
         for (reset_param(p); p->end == false; next_param(p)) {
                 int index;
                 read_cur(p, cur_value, mgr);
 
+                if (false == mgr->accepted(cur_value, data)) continue;
+
                 mgr->encoder(cur_value, &index,    rank, p, mgr);
                 mgr->decoder(index,     new_value, rank, p, mgr);
 
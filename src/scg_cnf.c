@@ -0,0 +1,511 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "scg_cnf.h"
+
+static void translate_comment (void *arg, const char *text, size_t len);
+static void translate_expr    (void *arg, const char *expr, size_t len);
+static int  parse_node     (cnf_t *cnf, const char **s, const char *end);
+static int  new_node       (cnf_t *cnf, char op, int lit);
+static int  var_of_name    (const cnf_t *cnf, const char *name, size_t len);
+static int  var_of_x       (const data_t *data, int i, int j, int k, int n);
+static bool parse_x        (const cnf_t *cnf, const char *name, size_t len, int *i, int *j, int *k);
+static void declare_x      (cnf_t *cnf, const char *name, size_t len, int min, int max);
+
+static int  lit_of   (cnf_t *cnf, int node, bool positive);
+static void emit     (cnf_t *cnf, int node, bool positive, int base);
+static void push_lit (cnf_t *cnf, int lit);
+static void print_clause (cnf_t *cnf, int base);
+
+static void broken (const char *line, size_t len);
+
+void init_cnf (cnf_t *cnf, const data_t *data, bool polarity)
+{
+        const int size  = data->size;
+        const int ncells = size * size * (data->bound + 1);
+
+        cnf->data  = data;
+        cnf->polarity = polarity;
+        cnf->xbase = ncells * (size + 1);
+        cnf->ybase = cnf->xbase + ncells * size;
+        cnf->nvars = cnf->ybase; // Z variables are added when the first constraint is read.
+        cnf->nclauses = 0;
+
+        cnf->in_header = true;
+        init_sink(&(cnf->comments), NULL, false, false);
+
+        cnf->tmp = tmpfile();
+        if (cnf->tmp == NULL) {
+                fprintf(stderr, "ERROR: Cannot create a temporary file.\n");
+                exit(EXIT_FAILURE);
+        }
+        init_sink(&(cnf->clauses), cnf->tmp, true, false);
+
+        init_sexp_reader(&(cnf->reader), translate_expr, translate_comment, cnf);
+
+        cnf->nnodes  = 0;
+        cnf->nodecap = BUFSIZ;
+        cnf->plen    = 0;
+        cnf->pcap    = BUFSIZ;
+
+        cnf->node   = (cnf_node_t*)malloc(sizeof(cnf_node_t) * cnf->nodecap);
+        cnf->prefix = (int*)malloc(sizeof(int) * cnf->pcap);
+        if (cnf->node == NULL || cnf->prefix == NULL) {
+                fprintf(stderr, "ERROR: Memory allocation failed.\n");
+                exit(EXIT_FAILURE);
+        }
+}
+
+void delete_cnf (cnf_t *cnf)
+{
+        fclose(cnf->tmp);
+        delete_sexp_reader(&(cnf->reader));
+        free(cnf->node);
+        free(cnf->prefix);
+}
+
+// Print out the header, the map of X variables in step 0, and all clauses.
+// The map consists of lines "c x_i_j_0 n v", which means that x_i_j_0 = n if and only if v is true.
+void finish_cnf (cnf_t *cnf, sink_t *out)
+{
+        finish_sexp_reader(&(cnf->reader));
+
+        const data_t *data = cnf->data;
+        const int size = data->size;
+
+        sink_write(out, cnf->comments.buf, cnf->comments.len);
+        sink_printf(out, "c map rank %d\n", data->rank);
+        for (int i = 0; i < size; i++) {
+                for (int j = 0; j < size; j++) {
+                        for (int n = 1; n <= size; n++) {
+                                sink_printf(out, "c x_%d_%d_0 %d %d\n", i, j, n, var_of_x(data, i, j, 0, n));
+                        }
+                }
+        }
+        sink_printf(out, "p cnf %d %lld\n", cnf->nvars, cnf->nclauses);
+
+        delete_sink(&(cnf->clauses));
+        delete_sink(&(cnf->comments));
+
+        char buf[BUFSIZ];
+        size_t n;
+        rewind(cnf->tmp);
+        while ((n = fread(buf, 1, sizeof(buf), cnf->tmp)) > 0) {
+                sink_write(out, buf, n);
+        }
+        if (ferror(cnf->tmp)) {
+                fprintf(stderr, "ERROR: Cannot read the temporary file.\n");
+                exit(EXIT_FAILURE);
+        }
+}
+
+// Get the value of an X variable in step k from a variable of DIMACS, if it is such a variable.
+bool decode_cnf_var (const data_t *data, int var, int *i, int *j, int *k, int *n)
+{
+        const int size = data->size;
+
+        if (var < 1 || size * size * (data->bound + 1) * (size + 1) < var) return false;
+
+        int v = var - 1;
+        *n = v % (size + 1);   v = v / (size + 1);
+        *j = v % size;         v = v / size;
+        *i = v % size;         v = v / size;
+        *k = v;
+
+        return true;
+}
+
+static int var_of_x (const data_t *data, int i, int j, int k, int n)
+{
+        const int size = data->size;
+        return 1 + ((k * size + i) * size + j) * (size + 1) + n;
+}
+
+// Comments before the first constraint are kept as the header, and the others are dropped.
+static void translate_comment (void *arg, const char *text, size_t len)
+{
+        cnf_t *cnf = (cnf_t*)arg;
+
+        if (false == cnf->in_header) return;
+
+        sink_putc(&(cnf->comments), 'c');
+        sink_write(&(cnf->comments), text, len);
+        sink_putc(&(cnf->comments), '\n');
+}
+
+// Translate an expression in the Sugar format, which is a declaration or a constraint.
+// Note: expr[len] is a terminator, so that numbers can be read by strtol().
+static void translate_expr (void *arg, const char *expr, size_t len)
+{
+        cnf_t *cnf = (cnf_t*)arg;
+
+        if (cnf->in_header) {
+                cnf->in_header = false;
+                cnf->nvars = cnf->ybase + cnf->data->nissued; // all strategies have been added.
+        }
+
+        const char *s   = expr;
+        const char *end = expr + len;
+
+        cnf->nnodes = 0;
+        const int root = parse_node(cnf, &s, end);
+
+        if (s != end) broken(expr, len);
+
+        if (root >= 0) {
+                assert(cnf->plen == 0);
+                emit(cnf, root, true, 0);
+        }
+}
+
+// Parse an expression, and return its node, or -1 for a declaration.
+static int parse_node (cnf_t *cnf, const char **s, const char *end)
+{
+        const char *p = *s;
+        while (p < end && *p == ' ') p++;
+        if (p == end) broken(*s, end - *s);
+
+        if (*p != '(') { // name of a boolean variable
+                const char *q = p;
+                while (q < end && *q != ' ' && *q != ')') q++;
+
+                *s = q;
+                return new_node(cnf, 'l', var_of_name(cnf, p, q - p));
+        }
+
+        p++;
+        const char *op = p;
+        while (p < end && *p != ' ' && *p != ')') p++;
+        const size_t oplen = p - op;
+
+        if (oplen == 3 && memcmp(op, "int", 3) == 0) { // (int x_i_j_k min max)
+                while (p < end && *p == ' ') p++;
+                const char *name = p;
+                while (p < end && *p != ' ') p++;
+                const size_t namelen = p - name;
+
+                char *q;
+                const int min = (int)strtol(p, &q, 10);
+                const int max = (int)strtol(q, &q, 10);
+                while (q < end && *q == ' ') q++;
+                if (q == end || *q != ')') broken(op - 1, end - op + 1);
+
+                declare_x(cnf, name, namelen, min, max);
+                *s = q + 1;
+                return -1;
+        }
+
+        if (oplen == 4 && memcmp(op, "bool", 4) == 0) { // (bool y), (bool z), or (bool p): numbered already
+                const char *q = memchr(p, ')', end - p);
+                if (q == NULL) broken(op - 1, end - op + 1);
+                *s = q + 1;
+                return -1;
+        }
+
+        if ((oplen == 1 && op[0] == '=') || (oplen == 2 && memcmp(op, "!=", 2) == 0)) { // (= x n), (!= x n)
+                while (p < end && *p == ' ') p++;
+                const char *name = p;
+                while (p < end && *p != ' ') p++;
+                const size_t namelen = p - name;
+
+                char *q;
+                const int n = (int)strtol(p, &q, 10);
+                while (q < end && *q == ' ') q++;
+                if (q == end || *q != ')') broken(op - 1, end - op + 1);
+
+                int i, j, k;
+                if (false == parse_x(cnf, name, namelen, &i, &j, &k) || n < 0 || cnf->data->size < n) {
+                        broken(op - 1, end - op + 1);
+                }
+
+                const int lit = var_of_x(cnf->data, i, j, k, n);
+                *s = q + 1;
+                return new_node(cnf, 'l', op[0] == '=' ? lit: -lit);
+        }
+
+        char type;
+        if      (oplen == 3 && memcmp(op, "and", 3) == 0) type = 'a';
+        else if (oplen == 2 && memcmp(op, "or",  2) == 0) type = 'o';
+        else if (oplen == 3 && memcmp(op, "not", 3) == 0) type = 'n';
+        else if (oplen == 3 && memcmp(op, "iff", 3) == 0) type = 'i';
+        else if (oplen == 3 && memcmp(op, "imp", 3) == 0) type = 'm';
+        else {
+                fprintf(stderr, "ERROR: Cannot translate %.*s into CNF.\n", (int)oplen, op);
+                exit(EXIT_FAILURE);
+        }
+
+        const int node = new_node(cnf, type, 0);
+        int last = -1;
+        int nchildren = 0;
+
+        for (;;) {
+                while (p < end && *p == ' ') p++;
+                if (p == end) broken(op - 1, end - op + 1);
+                if (*p == ')') break;
+
+                const int child = parse_node(cnf, &p, end);
+                if (child < 0) broken(op - 1, end - op + 1);
+
+                if (last < 0) cnf->node[node].child = child;
+                else          cnf->node[last].next  = child;
+                last = child;
+                nchildren++;
+        }
+
+        if ((type == 'n' && nchildren != 1) || ((type == 'i' || type == 'm') && nchildren != 2)) {
+                broken(op - 1, end - op + 1);
+        }
+
+        *s = p + 1;
+        return node;
+}
+
+static int new_node (cnf_t *cnf, char op, int lit)
+{
+        if (cnf->nnodes == cnf->nodecap) {
+                cnf->nodecap *= 2;
+                cnf->node = (cnf_node_t*)realloc(cnf->node, sizeof(cnf_node_t) * cnf->nodecap);
+                if (cnf->node == NULL) {
+                        fprintf(stderr, "ERROR: Memory allocation failed.\n");
+                        exit(EXIT_FAILURE);
+                }
+        }
+
+        cnf_node_t *x = &(cnf->node[cnf->nnodes]);
+        x->op    = op;
+        x->lit   = lit;
+        x->child = -1;
+        x->next  = -1;
+        x->defined = 0;
+
+        return cnf->nnodes++;
+}
+
+// Get the variable of y_i_j_n_k, z_m, or p_i_j_n_k,
+// where the placement variable p_i_j_n_k of the onehot encoding is that of x_i_j_k = n.
+static int var_of_name (const cnf_t *cnf, const char *name, size_t len)
+{
+        const data_t *data = cnf->data;
+        const int size = data->size;
+
+        int  v[4];
+        int  nv = 0;
+        const char *p   = name + 1;
+        const char *end = name + len;
+
+        while (p < end && nv < 4 && *p == '_') {
+                char *q;
+                v[nv++] = (int)strtol(p + 1, &q, 10);
+                if (q == p + 1) break;
+                p = q;
+        }
+
+        if (p == end && name[0] == 'y' && nv == 4
+         && 0 <= v[0] && v[0] < size && 0 <= v[1] && v[1] < size
+         && 1 <= v[2] && v[2] <= size && 0 <= v[3] && v[3] <= data->bound) {
+                return cnf->xbase + ((v[3] * size + v[0]) * size + v[1]) * size + (v[2] - 1) + 1;
+        }
+
+        if (p == end && name[0] == 'p' && nv == 4
+         && 0 <= v[0] && v[0] < size && 0 <= v[1] && v[1] < size
+         && 1 <= v[2] && v[2] <= size && 0 <= v[3] && v[3] <= data->bound) {
+                return var_of_x(data, v[0], v[1], v[3], v[2]);
+        }
+
+        if (p == end && name[0] == 'z' && nv == 1 && 0 <= v[0] && v[0] < data->nissued) {
+                return cnf->ybase + v[0] + 1;
+        }
+
+        fprintf(stderr, "ERROR: Unknown variable %.*s\n", (int)len, name);
+        exit(EXIT_FAILURE);
+}
+
+static bool parse_x (const cnf_t *cnf, const char *name, size_t len, int *i, int *j, int *k)
+{
+        char tmp[64];
+        if (len >= sizeof(tmp)) return false;
+
+        memcpy(tmp, name, len);
+        tmp[len] = '\0';
+
+        return parse_name_of_x(tmp, NULL, cnf->data->size, cnf->data->bound, i, j, k);
+}
+
+// Exactly one of the one-hot variables of x_i_j_k is true.
+static void declare_x (cnf_t *cnf, const char *name, size_t len, int min, int max)
+{
+        const data_t *data = cnf->data;
+
+        int i, j, k;
+        if (min != 0 || max != data->size || false == parse_x(cnf, name, len, &i, &j, &k)) {
+                fprintf(stderr, "ERROR: Unknown variable %.*s\n", (int)len, name);
+                exit(EXIT_FAILURE);
+        }
+
+        for (int n = min; n <= max; n++) {
+                push_lit(cnf, var_of_x(data, i, j, k, n));
+        }
+        print_clause(cnf, 0);
+        cnf->plen = 0;
+
+        for (int n = min; n <= max; n++) {
+                for (int m = n + 1; m <= max; m++) {
+                        push_lit(cnf, -var_of_x(data, i, j, k, n));
+                        push_lit(cnf, -var_of_x(data, i, j, k, m));
+                        print_clause(cnf, 0);
+                        cnf->plen = 0;
+                }
+        }
+}
+
+// Get a literal equivalent to a node, introducing an auxiliary variable for a compound one,
+// which is recorded in the node so that it is defined only once.
+//
+// With polarity, the literal is only as strong as its occurrence needs (Plaisted-Greenbaum):
+// (imp g node) is defined if it occurs positively, and (imp node g) otherwise,
+// which is equisatisfiable because g occurs nowhere but in place of the node.
+// Bit 1 of x->defined records the former direction, and bit 2 the latter.
+static int lit_of (cnf_t *cnf, int node, bool positive)
+{
+        const cnf_node_t *x = &(cnf->node[node]);
+
+        if (x->op == 'l') return x->lit;
+        if (x->op == 'n') return -lit_of(cnf, x->child, !positive);
+
+        if (x->lit == 0) cnf->node[node].lit = ++(cnf->nvars);
+        const int g = cnf->node[node].lit;
+
+        const char need = (false == cnf->polarity) ? 3: (positive ? 1: 2);
+        const char todo = need & ~(cnf->node[node].defined);
+        cnf->node[node].defined |= need;
+
+        const int base = cnf->plen;
+
+        if (todo & 1) {
+                push_lit(cnf, -g);
+                emit(cnf, node, true, base);
+                cnf->plen = base;
+        }
+
+        if (todo & 2) {
+                push_lit(cnf, g);
+                emit(cnf, node, false, base);
+                cnf->plen = base;
+        }
+
+        return g;
+}
+
+// Print out clauses equivalent to (or P node) if positive, and to (or P (not node)) otherwise,
+// where P is the disjunction of prefix[base], ..., prefix[plen-1].
+// Conjunctions are distributed over P, so that no auxiliary variable is needed
+// for the definitions of Z variables and transitions, i.e., (iff a (and ...)) and (iff a (or ...)).
+static void emit (cnf_t *cnf, int node, bool positive, int base)
+{
+        const cnf_node_t x = cnf->node[node];
+        const int top = cnf->plen;
+
+        switch (x.op) {
+                case 'l':
+                        push_lit(cnf, positive ? x.lit: -x.lit);
+                        print_clause(cnf, base);
+                        break;
+
+                case 'n':
+                        emit(cnf, x.child, !positive, base);
+                        break;
+
+                case 'a':
+                case 'o':
+                        if (positive == (x.op == 'a')) { // conjunction
+                                for (int c = x.child; c >= 0; c = cnf->node[c].next) {
+                                        emit(cnf, c, positive, base);
+                                }
+                        } else { // disjunction
+                                for (int c = x.child; c >= 0; c = cnf->node[c].next) {
+                                        const int lit = lit_of(cnf, c, positive);
+                                        push_lit(cnf, positive ? lit: -lit);
+                                }
+                                print_clause(cnf, base);
+                        }
+                        break;
+
+                case 'm':
+                case 'i': {
+                        const int a = x.child;
+                        const int b = cnf->node[a].next;
+
+                        if (x.op == 'm' && false == positive) { // (and A (not B))
+                                emit(cnf, a, true,  base);
+                                emit(cnf, b, false, base);
+                                break;
+                        }
+
+                        // (not A) as a disjunction
+                        if (cnf->node[a].op == 'a') {
+                                for (int c = cnf->node[a].child; c >= 0; c = cnf->node[c].next) {
+                                        push_lit(cnf, -lit_of(cnf, c, false));
+                                }
+                        } else {
+                                push_lit(cnf, -lit_of(cnf, a, false));
+                        }
+
+                        emit(cnf, b, positive, base);
+                        cnf->plen = top;
+
+                        if (x.op == 'm') break;
+
+                        // A as a disjunction
+                        if (cnf->node[a].op == 'o') {
+                                for (int c = cnf->node[a].child; c >= 0; c = cnf->node[c].next) {
+                                        push_lit(cnf, lit_of(cnf, c, true));
+                                }
+                        } else {
+                                push_lit(cnf, lit_of(cnf, a, true));
+                        }
+
+                        emit(cnf, b, !positive, base);
+                        break;
+                }
+
+                default:
+                        assert(0);
+        }
+
+        cnf->plen = top;
+}
+
+static void push_lit (cnf_t *cnf, int lit)
+{
+        if (cnf->plen == cnf->pcap) {
+                cnf->pcap *= 2;
+                cnf->prefix = (int*)realloc(cnf->prefix, sizeof(int) * cnf->pcap);
+                if (cnf->prefix == NULL) {
+                        fprintf(stderr, "ERROR: Memory allocation failed.\n");
+                        exit(EXIT_FAILURE);
+                }
+        }
+
+        cnf->prefix[cnf->plen++] = lit;
+}
+
+static void print_clause (cnf_t *cnf, int base)
+{
+        sink_t *out = &(cnf->clauses);
+
+        for (int pos = base; pos < cnf->plen; pos++) {
+                sink_putint(out, cnf->prefix[pos]);
+                sink_putc(out, ' ');
+        }
+        sink_puts(out, "0\n");
+
+        cnf->nclauses++;
+}
+
+static void broken (const char *line, size_t len)
+{
+        fprintf(stderr, "ERROR: Cannot parse %.*s\n", (int)(len < 80 ? len: 80), line);
+        exit(EXIT_FAILURE);
+}
@@ -0,0 +1,58 @@
+#ifndef SCG_CNF_H
+#define SCG_CNF_H
+
+#include "scg_modeler.h"
+#include "scg_sexp.h"
+
+typedef struct st_cnf      cnf_t;
+typedef struct st_cnf_node cnf_node_t;
+
+// node of a constraint parsed from the Sugar format
+struct st_cnf_node {
+        char op;    // a: and, o: or, n: not, i: iff, m: imp, l: literal
+        int  lit;   // literal in DIMACS, for op l
+        int  child; // first child, or -1
+        int  next;  // next sibling, or -1
+        char defined; // directions in which the auxiliary variable of a compound node is defined (see lit_of())
+};
+
+// translator of constraints in the Sugar format into DIMACS CNF.
+// Constraints are fed through a filter sink into the reader,
+// and clauses are spooled into a temporary file until the numbers of variables and clauses are known.
+//
+// Variables of DIMACS are numbered as follows:
+// x_i_j_k = n : one-hot, 1 + ((k*size+i)*size+j)*(size+1) + n for 0 <= n <= size,
+// y_i_j_n_k   : xbase + ((k*size+i)*size+j)*size + (n-1) + 1,
+// z_m         : ybase + m + 1,
+// and auxiliary variables of the Tseitin encoding follow them.
+struct st_cnf {
+        const data_t *data;
+        bool polarity; // whether auxiliary variables are defined only in the directions in which they occur
+
+        int xbase;  // number of variables for X variables
+        int ybase;  // xbase plus the number of Y variables
+        int nvars;  // number of variables used so far
+        long long nclauses;
+
+        bool    in_header; // whether no constraint has been read yet
+        sink_t  comments;  // comments in the header, printed as those of DIMACS
+        FILE   *tmp;       // spooled clauses
+        sink_t  clauses;
+
+        sexp_reader_t reader;
+
+        cnf_node_t *node; // nodes of the constraint being translated
+        int nnodes;
+        int nodecap;
+
+        int *prefix; // literals shared by the clauses being printed (see emit())
+        int  plen;
+        int  pcap;
+};
+
+extern void init_cnf    (cnf_t *cnf, const data_t *data, bool polarity);
+extern void delete_cnf  (cnf_t *cnf);
+extern void finish_cnf  (cnf_t *cnf, sink_t *out);
+extern bool decode_cnf_var (const data_t *data, int var, int *i, int *j, int *k, int *n);
+
+#endif /*SCG_CNF_H*/
@@ -0,0 +1,233 @@
+#define _POSIX_C_SOURCE 200809L // for fdopen() and kill()
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "scg_exec.h"
+#include "scg_cnf.h"
+
+static void *run_reader (void *arg);
+
+// Run the command by /bin/sh, and connect its stdin and stdout to pipes.
+// Constraints written to solver->in are read by the solver while they are generated:
+// writes block whenever the solver does not keep up.
+void start_solver (solver_t *solver, const char *command)
+{
+        int to_solver[2], from_solver[2];
+
+        if (pipe(to_solver) != 0 || pipe(from_solver) != 0) {
+                fprintf(stderr, "ERROR: Cannot create pipes.\n");
+                exit(EXIT_FAILURE);
+        }
+
+        fflush(stdout);
+        fflush(stderr);
+
+        const pid_t pid = fork();
+        if (pid < 0) {
+                fprintf(stderr, "ERROR: Cannot start %s\n", command);
+                exit(EXIT_FAILURE);
+        }
+
+        if (pid == 0) { // solver
+                dup2(to_solver[0],   STDIN_FILENO);
+                dup2(from_solver[1], STDOUT_FILENO);
+                close(to_solver[0]);
+                close(to_solver[1]);
+                close(from_solver[0]);
+                close(from_solver[1]);
+
+                execl("/bin/sh", "sh", "-c", command, (char*)NULL);
+                fprintf(stderr, "ERROR: Cannot start %s\n", command);
+                _exit(127);
+        }
+
+        close(to_solver[0]);
+        close(from_solver[1]);
+
+        // report a solver which exits early as a write error, not by SIGPIPE.
+        signal(SIGPIPE, SIG_IGN);
+
+        solver->pid    = pid;
+        solver->fd_out = from_solver[0];
+        solver->in     = fdopen(to_solver[1], "w");
+        if (solver->in == NULL) {
+                fprintf(stderr, "ERROR: Cannot open the pipe to %s\n", command);
+                exit(EXIT_FAILURE);
+        }
+
+        solver->cap = BUFSIZ;
+        solver->len = 0;
+        solver->log = (char*)malloc(solver->cap);
+        if (solver->log == NULL) {
+                fprintf(stderr, "ERROR: Memory allocation failed.\n");
+                exit(EXIT_FAILURE);
+        }
+
+        // The solver must be able to print out while it is still reading constraints.
+        if (pthread_create(&(solver->reader), NULL, run_reader, solver) != 0) {
+                fprintf(stderr, "ERROR: Cannot create a thread.\n");
+                kill(pid, SIGTERM);
+                exit(EXIT_FAILURE);
+        }
+}
+
+// Close the stdin of the solver, wait for its termination, and return its exit status.
+int finish_solver (solver_t *solver)
+{
+        if (fclose(solver->in) != 0) {
+                fprintf(stderr, "ERROR: Cannot write constraints.\n");
+                exit(EXIT_FAILURE);
+        }
+        solver->in = NULL;
+
+        pthread_join(solver->reader, NULL);
+        close(solver->fd_out);
+
+        int status;
+        if (waitpid(solver->pid, &status, 0) != solver->pid) {
+                fprintf(stderr, "ERROR: Cannot wait for the solver.\n");
+                exit(EXIT_FAILURE);
+        }
+
+        solver->log[solver->len] = '\0';
+
+        return WIFEXITED(status) ? WEXITSTATUS(status): EXIT_FAILURE;
+}
+
+void delete_solver (solver_t *solver)
+{
+        assert(solver->in == NULL); // finish_solver() must be called in advance.
+
+        free(solver->log);
+        solver->log = NULL;
+}
+
+static void *run_reader (void *arg)
+{
+        solver_t *solver = (solver_t*)arg;
+
+        for (;;) {
+                if (solver->len + BUFSIZ + 1 > solver->cap) {
+                        char *log = (char*)realloc(solver->log, solver->cap * 2);
+                        if (log == NULL) {
+                                fprintf(stderr, "ERROR: Memory allocation failed.\n");
+                                exit(EXIT_FAILURE);
+                        }
+                        solver->log = log;
+                        solver->cap = solver->cap * 2;
+                }
+
+                const ssize_t n = read(solver->fd_out, solver->log + solver->len, BUFSIZ);
+                if (n <= 0) break;
+
+                solver->len += (size_t)n;
+        }
+
+        return NULL;
+}
+
+// Decode the output of the solver like out2str:
+// print out the status line, and the initial grid if the solver found a model.
+// Lines "a x n" give the values of X variables, and only those of step 0 are used.
+// For DIMACS CNF, lines "v lit ..." of a SAT solver are decoded instead (see decode_cnf_var()),
+// and for SMT-LIB2, the status and the answer "((x_i_j_0 n) ...)" to get-value.
+// In the onehot encoding, placement variables "a p_i_j_n_0 true" and "(p_i_j_n_0 true)" are read instead.
+// Return true if a model is found.
+bool fprint_grid_from_log (FILE *out, solver_t *solver, const data_t *data, const names_t *names, int format)
+{
+        const int size = data->size;
+
+        int *grid = (int*)malloc(sizeof(int) * size * size);
+        if (grid == NULL) {
+                fprintf(stderr, "ERROR: Memory allocation failed.\n");
+                exit(EXIT_FAILURE);
+        }
+        for (int pos = 0; pos < size * size; pos++) {
+                grid[pos] = 0;
+        }
+
+        bool found = false;
+
+        for (char *line = solver->log; line < solver->log + solver->len; ) {
+                char *eol = strchr(line, '\n');
+                if (eol != NULL) *eol = '\0';
+
+                char name[64];
+                int  i, j, k, n;
+
+                if (format == FORMAT_SMT2) {
+                        if      (strcmp(line, "sat")   == 0) fprintf(out, "s SATISFIABLE\n");
+                        else if (strcmp(line, "unsat") == 0) fprintf(out, "s UNSATISFIABLE\n");
+                        else if (strcmp(line, "unknown") == 0) fprintf(out, "s UNKNOWN\n");
+                        found = found || (strcmp(line, "sat") == 0);
+
+                        for (char *s = strstr(line, "(p_"); s != NULL; s = strstr(s + 1, "(p_")) {
+                                char value[8];
+                                if (sscanf(s, "(p_%d_%d_%d_%d %7[a-z]", &i, &j, &n, &k, value) == 5
+                                 && k == 0 && strcmp(value, "true") == 0
+                                 && 0 <= i && i < size && 0 <= j && j < size && 1 <= n && n <= size) {
+                                        grid[i * size + j] = n;
+                                }
+                        }
+
+                        for (char *s = strstr(line, "(x_"); s != NULL; s = strstr(s + 1, "(x_")) {
+                                if (sscanf(s + 1, "%63[^ )] %d", name, &n) == 2
+                                 && parse_name_of_x(name, NULL, size, data->bound, &i, &j, &k)
+                                 && k == 0 && 0 <= n && n <= size) {
+                                        grid[i * size + j] = n;
+                                }
+                        }
+
+                } else if (line[0] == 's') {
+                        fprintf(out, "%s\n", line);
+                        found = found || (strcmp(line, "s SATISFIABLE") == 0);
+
+                } else if (format == FORMAT_CNF && line[0] == 'v') { // v lit lit ... 0
+                        for (char *s = line + 1, *t; ; s = t) {
+                                const long lit = strtol(s, &t, 10);
+                                if (t == s || lit == 0) break;
+
+                                if (decode_cnf_var(data, (int)lit, &i, &j, &k, &n) && k == 0 && n > 0) {
+                                        grid[i * size + j] = n;
+                                }
+                        }
+
+                } else if (sscanf(line, "a p_%d_%d_%d_%d %63s", &i, &j, &n, &k, name) == 5) {
+                        if (k == 0 && strcmp(name, "true") == 0
+                         && 0 <= i && i < size && 0 <= j && j < size && 1 <= n && n <= size) {
+                                grid[i * size + j] = n;
+                        }
+
+                } else if (sscanf(line, "a %63s %d", name, &n) == 2
+                        && parse_name_of_x(name, names, size, data->bound, &i, &j, &k)
+                        && k == 0) {
+
+                        if (n < 0 || size < n) {
+                                fprintf(stderr, "ERROR: Invalid assignment: %s\n", line);
+                                exit(EXIT_FAILURE);
+                        }
+                        grid[i * size + j] = n;
+                }
+
+                if (eol == NULL) break;
+                *eol = '\n';
+                line = eol + 1;
+        }
+
+        if (found) {
+                for (int pos = 0; pos < size * size; pos++) {
+                        fprintf(out, "%d", grid[pos]);
+                }
+                fprintf(out, "\n");
+        }
+
+        free(grid);
+
+        return found;
+}
@@ -0,0 +1,27 @@
+#ifndef SCG_EXEC_H
+#define SCG_EXEC_H
+
+#include<sys/types.h>
+
+#include "scg_modeler.h"
+
+typedef struct st_solver solver_t;
+
+// solver process which reads constraints from its stdin
+struct st_solver {
+        pid_t pid;
+        FILE *in;        // stdin of the solver, to which constraints are written
+        int   fd_out;    // stdout of the solver
+
+        pthread_t reader; // collects the stdout of the solver
+        char  *log;       // whole stdout of the solver
+        size_t len;
+        size_t cap;
+};
+
+extern void start_solver  (solver_t *solver, const char *command);
+extern int  finish_solver (solver_t *solver);
+extern void delete_solver (solver_t *solver);
+extern bool fprint_grid_from_log (FILE *out, solver_t *solver, const data_t *data, const names_t *names, int format);
+
+#endif /*SCG_EXEC_H*/
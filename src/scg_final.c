@@ -0,0 +1,190 @@
+#include <assert.h>
+
+#include "scg_final.h"
+#include "scg_assert.h"
+
+// values of auxiliary parameter (kinds of flags)
+#define FS_UNCHANGED (0) // no candidate of the cell changes in the step
+#define FS_STABLE    (1) // no candidate of any non-clue cell changes in the step (only for cell (0,0))
+#define FS_COMPLETE  (2) // some number is placed at every non-clue cell in the step (only for cell (0,0))
+#define FS_MIN FS_UNCHANGED
+#define FS_MAX FS_COMPLETE
+
+static void fprint_cons_for_z_in_final_flags (sink_t *out, data_t *data);
+static bool accepted_FS_version (const int *buf, const data_t *data);
+static void fprint_flag         (sink_t *out, const data_t *data, int kind, int i, int j, int k);
+
+void add_final_variables (data_t *data)
+{
+        param_t *p = data->p;
+
+        const int pid_FS_D = add_param(FS_MIN, FS_MAX, tag_FS_D, p);
+
+        assert(pid_FS_D >= 0);
+
+        const int pid_I = data->pid_I;
+        const int pid_J = data->pid_J;
+        const int pid_K = data->pid_K;
+
+        int nvars = 1;
+        for (int pid = 0; pid < p->npars; pid++) {
+                if (pid == pid_I || pid == pid_J || pid == pid_K || pid == pid_FS_D) {
+                        nvars = nvars * (p->max[pid] - p->min[pid] + 1);
+                }
+        }
+        // NOTE: for simplicity, more variables are requested than needed.
+        // The function accepted() decides whether variables really appear in constraints.
+
+        const int len = 4;
+
+        assert(len == 4);
+        int buf[len];
+        buf[0] = pid_I;
+        buf[1] = pid_J;
+        buf[2] = pid_K;
+        buf[3] = pid_FS_D;
+        add_strategy(data, tag_FS, nvars, buf, len,
+                        default_encoder,
+                        default_decoder,
+                        accepted_FS_version,
+                        NULL,
+                        NULL,
+                        fprint_cons_for_z_in_final_flags);
+}
+
+// Print out (imp stable_k complete_k) for each step k but the initial one,
+// or for the last step of each round in sequential mode (see fprint_cons_for_final()).
+void fprint_final_by_flags (sink_t *out, const data_t *data)
+{
+        const param_t *p = data->p;
+
+        for (int k = p->min[data->pid_K] + data->round; k <= p->max[data->pid_K]; k += data->round) {
+                sink_puts(out, "(imp ");
+                fprint_flag(out, data, FS_STABLE,   0, 0, k);
+                fprint_flag(out, data, FS_COMPLETE, 0, 0, k);
+                sink_endexpr(out, ")\n");
+        }
+}
+
+// A stable state is a fixpoint of the steps, so that the next step is stable as well,
+// and placed numbers are never removed.
+void fprint_hints_for_final_flags (sink_t *out, const data_t *data)
+{
+        const param_t *p = data->p;
+
+        for (int k = p->min[data->pid_K] + data->round; k < p->max[data->pid_K]; k += data->round) {
+                for (int kind = FS_STABLE; kind <= FS_COMPLETE; kind++) {
+                        sink_puts(out, "(imp ");
+                        fprint_flag(out, data, kind, 0, 0, k);
+                        fprint_flag(out, data, kind, 0, 0, k + data->round);
+                        sink_endexpr(out, ")\n");
+                }
+        }
+}
+
+// Print out the definitions of the flags of each step,
+// in which those of the steps are over the indicators of non-clue cells.
+static void fprint_cons_for_z_in_final_flags (sink_t *out, data_t *data)
+{
+        sink_puts(out, ";\n");
+        sink_puts(out, "; Constraints for Flags of Final States\n");
+
+        const param_t *p = data->p;
+
+        const int size = data->size;
+        const int rank = data->rank;
+
+        for (int k = p->min[data->pid_K] + data->round; k <= p->max[data->pid_K]; k += data->round) {
+                for (int c = 0; c < size * size; c++) {
+                        if (data->clue[c]) continue;
+
+                        const cell_t q = cell_at(c / size, c % size, rank);
+
+                        sink_puts(out, "(iff ");
+                        fprint_flag(out, data, FS_UNCHANGED, q.I, q.J, k);
+                        sink_puts(out, "(and");
+                        for (int n = 1; n <= size; n++) {
+                                sink_puts(out, " (iff ");
+                                fprint_name_of_y(out, q.I, q.J, n, k - data->round);
+                                sink_putc(out, ' ');
+                                fprint_name_of_y(out, q.I, q.J, n, k);
+                                sink_puts(out, ")");
+                        }
+                        sink_endexpr(out, ") )\n");
+                }
+
+                for (int kind = FS_STABLE; kind <= FS_COMPLETE; kind++) {
+                        sink_puts(out, "(iff ");
+                        fprint_flag(out, data, kind, 0, 0, k);
+                        sink_puts(out, "(and ");
+                        for (int c = 0; c < size * size; c++) {
+                                if (data->clue[c]) continue;
+
+                                const cell_t q = cell_at(c / size, c % size, rank);
+
+                                if (kind == FS_STABLE) {
+                                        fprint_flag(out, data, FS_UNCHANGED, q.I, q.J, k);
+                                } else {
+                                        fprint_placed(out, data, q.I, q.J, k);
+                                }
+                        }
+                        sink_endexpr(out, ") )\n");
+                }
+        }
+}
+
+static void fprint_flag (sink_t *out, const data_t *data, int kind, int i, int j, int k)
+{
+        const idmgr_t *mgr = get_idmgr(tag_FS, data);
+        assert(mgr != NULL);
+
+        int buf[4];
+        assert(mgr->len == 4);
+        for (int pos = 0; pos < mgr->len; pos++) {
+                const int pid = mgr->pid[pos];
+                if      (pid == data->pid_I) buf[pos] = i;
+                else if (pid == data->pid_J) buf[pos] = j;
+                else if (pid == data->pid_K) buf[pos] = k;
+                else                         buf[pos] = kind;
+        }
+        assert(mgr->accepted(buf, data));
+
+        int index;
+        mgr->encoder(buf, &index, data->rank, data->p, mgr);
+        assert_variable_index(index, mgr);
+
+        fprint_z_literal(out, index);
+}
+
+// This function determines whether the combination of parameter values,
+// held by the array buf, is accepted or not.
+// Indicators are needed for non-clue cells, and the flags of steps only once, at cell (0,0).
+// The initial step has no flags, which is skipped by the constraints for final states,
+// and neither have the steps within a round in sequential mode.
+static bool accepted_FS_version (const int *buf, const data_t *data)
+{
+        const param_t *p = data->p;
+
+        const idmgr_t *mgr = get_idmgr(tag_FS, data);
+        assert(mgr != NULL);
+
+        const int pos_I    = pos_of_pid(data->pid_I, mgr);
+        const int pos_J    = pos_of_pid(data->pid_J, mgr);
+        const int pos_K    = pos_of_pid(data->pid_K, mgr);
+        const int pos_FS_D = pos_of_pid(get_param(tag_FS_D, p), mgr);
+
+        assert(pos_I    >= 0);
+        assert(pos_J    >= 0);
+        assert(pos_K    >= 0);
+        assert(pos_FS_D >= 0);
+
+        const int i = buf[pos_I];
+        const int j = buf[pos_J];
+
+        if (buf[pos_K] == p->min[data->pid_K])                    return false;
+        if ((buf[pos_K] - p->min[data->pid_K]) % data->round != 0) return false;
+
+        if (buf[pos_FS_D] != FS_UNCHANGED) return i == 0 && j == 0;
+
+        return false == data->clue[i * data->size + j];
+}
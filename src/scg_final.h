@@ -0,0 +1,21 @@
+#ifndef SCG_FINAL_H
+#define SCG_FINAL_H
+
+#include "scg_modeler.h"
+
+// Flags of final states, by which the constraint of each step k is a single clause (imp stable_k complete_k),
+// instead of one formula of the size^3 literals of Y variables in steps k-1 and k (see fprint_cons_for_final()):
+//
+// change indicator of a non-clue cell: unchanged_i_j_k <---> (and (iff y_i_j_n_k-1 y_i_j_n_k) ...) over all n,
+// stable_k   <---> (and unchanged_i_j_k ...) over all non-clue cells,
+// complete_k <---> (and placed_i_j_k ...)    over all non-clue cells,
+//
+// so that every constraint has O(size^2) literals at most.
+// In sequential mode, steps k-1 and k are replaced by the last steps of consecutive rounds, and so are k and k+1 below.
+// With --hints, the flags also persist: stable_k ---> stable_k+1, and complete_k ---> complete_k+1.
+extern void add_final_variables (data_t *data);
+
+extern void fprint_final_by_flags (sink_t *out, const data_t *data);
+extern void fprint_hints_for_final_flags (sink_t *out, const data_t *data);
+
+#endif /*SCG_FINAL_H*/
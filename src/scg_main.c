@@ -3,9 +3,19 @@
 #include<stdbool.h>
 #include<assert.h>
 #include<unistd.h>
+#include<getopt.h>
+#include<string.h>
 
 #include "scg_modeler.h"
 #include "scg_assert.h"
+#include "scg_exec.h"
+#include "scg_cnf.h"
+#include "scg_smt2.h"
+#include "scg_timed.h"
+#include "scg_reach.h"
+#include "scg_aggregate.h"
+#include "scg_final.h"
+#include "scg_symmetry.h"
 
 #include "sudoku_rule.h"
 #include "naked_singles.h"
@@ -21,19 +31,132 @@ typedef struct st_clarg {
         bool NS_enabled;
         bool HS_enabled;
         bool LC_enabled;
+
+        bool stats_enabled;
+
+        const char *names_file; // map of compact names, or NULL for full names
+        const char *command;    // solver to which constraints are piped, or NULL
+
+        bool predicates_enabled;
+
+        const char *skeleton_dir; // directory of cached skeletons, or NULL
+
+        bool estimate_enabled;
+
+        int format; // FORMAT_SUGAR, FORMAT_CNF, or FORMAT_SMT2
+
+        int encoding; // ENCODING_INT, ENCODING_ONEHOT, or ENCODING_TIME
+
+        bool prune_enabled;
+
+        bool polarity_enabled;
+        bool self_check_enabled;
+
+        bool aggregates_enabled;
+
+        int inline_limit; // maximum number of literals of inlined definitions of Z variables, or 0 if disabled
+
+        bool fused_enabled;
+
+        bool hints_enabled;
+
+        bool symmetry_enabled;
+        bool lex_leader_enabled;
+
+        bool final_flags_enabled;
+
+        bool sequential_enabled; // -k is the number of rounds, each of which has a step per strategy
 } clarg_t;
 
+// sizes of the sections of constraints, reported in estimate mode
+typedef struct st_estimate {
+        FILE *fp;         // where the report is printed
+        long long nbytes; // bytes before the current section
+        long long nexprs; // declarations and constraints before the current section
+} estimate_t;
+
+// codes of long options without short ones
+enum {
+        OPT_COMPACT_NAMES = 256,
+        OPT_EXEC,
+        OPT_PREDICATES,
+        OPT_SKELETON_CACHE,
+        OPT_ESTIMATE,
+        OPT_FORMAT,
+        OPT_ENCODING,
+        OPT_PRUNE,
+        OPT_POLARITY,
+        OPT_SELF_CHECK,
+        OPT_AGGREGATES,
+        OPT_INLINE,
+        OPT_FUSE,
+        OPT_HINTS,
+        OPT_SYMMETRY,
+        OPT_LEX_LEADER,
+        OPT_FINAL_FLAGS,
+        OPT_SEQUENTIAL,
+};
+
+static const struct option long_options[] = {
+        {"compact-names", required_argument, NULL, OPT_COMPACT_NAMES},
+        {"exec",          required_argument, NULL, OPT_EXEC},
+        {"predicates",    no_argument,       NULL, OPT_PREDICATES},
+        {"skeleton-cache", required_argument, NULL, OPT_SKELETON_CACHE},
+        {"estimate",      no_argument,       NULL, OPT_ESTIMATE},
+        {"format",        required_argument, NULL, OPT_FORMAT},
+        {"encoding",      required_argument, NULL, OPT_ENCODING},
+        {"prune",         no_argument,       NULL, OPT_PRUNE},
+        {"polarity",      no_argument,       NULL, OPT_POLARITY},
+        {"self-check",    no_argument,       NULL, OPT_SELF_CHECK},
+        {"aggregates",    no_argument,       NULL, OPT_AGGREGATES},
+        {"inline",        required_argument, NULL, OPT_INLINE},
+        {"fuse",          no_argument,       NULL, OPT_FUSE},
+        {"hints",         no_argument,       NULL, OPT_HINTS},
+        {"symmetry",      no_argument,       NULL, OPT_SYMMETRY},
+        {"lex-leader",    no_argument,       NULL, OPT_LEX_LEADER},
+        {"final-flags",   no_argument,       NULL, OPT_FINAL_FLAGS},
+        {"sequential",    no_argument,       NULL, OPT_SEQUENTIAL},
+        {NULL,            0,                 NULL, 0},
+};
+
 static void usage (void);
-static void print_cells (FILE *out, const cell_t *q, int n);
+static int  generate (const clarg_t *clarg, FILE *in, FILE *fp, bool gz, bool *found);
+static void print_cells (sink_t *out, const cell_t *q, int n);
+static void print_stats (FILE *out, const sink_t *sink);
+static bool has_suffix  (const char *s, const char *suffix);
+static void fprint_constraints (sink_t *out, data_t *data, estimate_t *est);
+static void measure_section    (estimate_t *est, sink_t *out, const char *name);
+static const char *name_of_strategy (stag_t tag);
+static FILE *open_skeleton     (const clarg_t *clarg, data_t *data, const sink_t *out);
 
 int main (int argc, char *argv[]){
         FILE* in  = NULL;
-        FILE* out = stdout;
+        FILE* fp  = stdout;
+        bool  gz  = false; // whether the output file is compressed
 
         clarg_t clarg;
 
         // default setting
         clarg.NS_enabled = clarg.HS_enabled = clarg.LC_enabled = false;
+        clarg.stats_enabled = false;
+        clarg.names_file    = NULL;
+        clarg.command       = NULL;
+        clarg.predicates_enabled = false;
+        clarg.skeleton_dir  = NULL;
+        clarg.estimate_enabled = false;
+        clarg.format = FORMAT_SUGAR;
+        clarg.encoding = ENCODING_INT;
+        clarg.prune_enabled = false;
+        clarg.polarity_enabled = false;
+        clarg.self_check_enabled = false;
+        clarg.aggregates_enabled = false;
+        clarg.inline_limit = 0;
+        clarg.fused_enabled = false;
+        clarg.hints_enabled = false;
+        clarg.symmetry_enabled = false;
+        clarg.lex_leader_enabled = false;
+        clarg.final_flags_enabled = false;
+        clarg.sequential_enabled = false;
         clarg.rank  = 2;
         clarg.bound =   (clarg.rank * clarg.rank)
                       * (clarg.rank * clarg.rank)
@@ -43,7 +166,7 @@ int main (int argc, char *argv[]){
         extern char  *optarg;
         extern int   optind, opterr;
 
-        while ((ch = getopt(argc, argv, "NHLr:k:o:h")) != -1) {
+        while ((ch = getopt_long(argc, argv, "NHLr:k:o:sh", long_options, NULL)) != -1) {
                 switch (ch) {
                         case 'N':
                                 clarg.NS_enabled = true;
@@ -70,11 +193,104 @@ int main (int argc, char *argv[]){
                                 assert(clarg.bound >= 0);
                                 break;
                         case 'o':
-                                out = fopen(optarg, "w");
-                                if (out == NULL) {
+                                fp = fopen(optarg, "w");
+                                if (fp == NULL) {
                                         fprintf(stderr, "Error: cannot open %s\n", optarg);
                                         exit(EXIT_FAILURE);
                                 }
+                                gz = has_suffix(optarg, ".gz");
+                                break;
+
+                        case 's':
+                                clarg.stats_enabled = true;
+                                break;
+
+                        case OPT_COMPACT_NAMES:
+                                clarg.names_file = optarg;
+                                break;
+
+                        case OPT_EXEC:
+                                clarg.command = optarg;
+                                break;
+
+                        case OPT_PREDICATES:
+                                clarg.predicates_enabled = true;
+                                break;
+
+                        case OPT_SKELETON_CACHE:
+                                clarg.skeleton_dir = optarg;
+                                break;
+
+                        case OPT_ESTIMATE:
+                                clarg.estimate_enabled = true;
+                                break;
+
+                        case OPT_FORMAT:
+                                if      (strcmp(optarg, "sugar") == 0) clarg.format = FORMAT_SUGAR;
+                                else if (strcmp(optarg, "cnf")   == 0) clarg.format = FORMAT_CNF;
+                                else if (strcmp(optarg, "smt2")  == 0) clarg.format = FORMAT_SMT2;
+                                else {
+                                        fprintf(stderr, "Error: unknown format %s\n", optarg);
+                                        exit(EXIT_FAILURE);
+                                }
+                                break;
+
+                        case OPT_ENCODING:
+                                if      (strcmp(optarg, "int")    == 0) clarg.encoding = ENCODING_INT;
+                                else if (strcmp(optarg, "onehot") == 0) clarg.encoding = ENCODING_ONEHOT;
+                                else if (strcmp(optarg, "time")   == 0) clarg.encoding = ENCODING_TIME;
+                                else {
+                                        fprintf(stderr, "Error: unknown encoding %s\n", optarg);
+                                        exit(EXIT_FAILURE);
+                                }
+                                break;
+
+                        case OPT_PRUNE:
+                                clarg.prune_enabled = true;
+                                break;
+
+                        case OPT_POLARITY:
+                                clarg.polarity_enabled = true;
+                                break;
+
+                        case OPT_SELF_CHECK:
+                                clarg.self_check_enabled = true;
+                                break;
+
+                        case OPT_AGGREGATES:
+                                clarg.aggregates_enabled = true;
+                                break;
+
+                        case OPT_INLINE:
+                                clarg.inline_limit = (int)strtol(optarg, NULL, 10);
+                                if (clarg.inline_limit < 1) {
+                                        fprintf(stderr, "Error: the limit of --inline must be 1 or larger.\n");
+                                        exit(EXIT_FAILURE);
+                                }
+                                break;
+
+                        case OPT_FUSE:
+                                clarg.fused_enabled = true;
+                                break;
+
+                        case OPT_HINTS:
+                                clarg.hints_enabled = true;
+                                break;
+
+                        case OPT_SYMMETRY:
+                                clarg.symmetry_enabled = true;
+                                break;
+
+                        case OPT_LEX_LEADER:
+                                clarg.lex_leader_enabled = true;
+                                break;
+
+                        case OPT_FINAL_FLAGS:
+                                clarg.final_flags_enabled = true;
+                                break;
+
+                        case OPT_SEQUENTIAL:
+                                clarg.sequential_enabled = true;
                                 break;
 
                         case 'h':
@@ -100,61 +316,288 @@ int main (int argc, char *argv[]){
                 exit(EXIT_FAILURE);
         }
 
+        if (clarg.estimate_enabled && (fp != stdout || clarg.command != NULL)) {
+                fprintf(stderr, "Error: --estimate cannot be used with -o or --exec.\n");
+                exit(EXIT_FAILURE);
+        }
+
+        if (clarg.format == FORMAT_CNF && clarg.predicates_enabled) {
+                fprintf(stderr, "Error: --predicates is not for the CNF format.\n");
+                exit(EXIT_FAILURE);
+        }
+        if (clarg.format != FORMAT_SUGAR && (clarg.names_file != NULL || clarg.estimate_enabled)) {
+                fprintf(stderr, "Error: --compact-names and --estimate are only for the Sugar format.\n");
+                exit(EXIT_FAILURE);
+        }
+
+        if (clarg.encoding != ENCODING_INT && clarg.names_file != NULL) {
+                fprintf(stderr, "Error: --compact-names is only for the int encoding.\n");
+                exit(EXIT_FAILURE);
+        }
+        if (clarg.encoding == ENCODING_TIME && (clarg.format != FORMAT_SUGAR || clarg.predicates_enabled)) {
+                fprintf(stderr, "Error: the time encoding is only for the Sugar format without --predicates.\n");
+                exit(EXIT_FAILURE);
+        }
+
+        if (clarg.prune_enabled && (clarg.skeleton_dir != NULL || clarg.encoding == ENCODING_TIME)) {
+                fprintf(stderr, "Error: --prune cannot be used with --skeleton-cache or the time encoding.\n");
+                exit(EXIT_FAILURE);
+        }
+
+        if (clarg.aggregates_enabled && (clarg.predicates_enabled || clarg.skeleton_dir != NULL || clarg.encoding == ENCODING_TIME)) {
+                fprintf(stderr, "Error: --aggregates cannot be used with --predicates, --skeleton-cache, or the time encoding.\n");
+                exit(EXIT_FAILURE);
+        }
+
+        if (clarg.inline_limit > 0 && (clarg.predicates_enabled || clarg.skeleton_dir != NULL || clarg.encoding == ENCODING_TIME)) {
+                fprintf(stderr, "Error: --inline cannot be used with --predicates, --skeleton-cache, or the time encoding.\n");
+                exit(EXIT_FAILURE);
+        }
+
+        if (clarg.fused_enabled && (clarg.predicates_enabled || clarg.encoding == ENCODING_TIME)) {
+                fprintf(stderr, "Error: --fuse cannot be used with --predicates or the time encoding.\n");
+                exit(EXIT_FAILURE);
+        }
+
+        if (clarg.hints_enabled && (clarg.skeleton_dir != NULL || clarg.encoding == ENCODING_TIME)) {
+                fprintf(stderr, "Error: --hints cannot be used with --skeleton-cache or the time encoding.\n");
+                exit(EXIT_FAILURE);
+        }
+
+        if ((clarg.symmetry_enabled || clarg.lex_leader_enabled) && (clarg.skeleton_dir != NULL || clarg.encoding == ENCODING_TIME)) {
+                fprintf(stderr, "Error: --symmetry and --lex-leader cannot be used with --skeleton-cache or the time encoding.\n");
+                exit(EXIT_FAILURE);
+        }
+
+        if (clarg.final_flags_enabled && (clarg.skeleton_dir != NULL || clarg.encoding == ENCODING_TIME)) {
+                fprintf(stderr, "Error: --final-flags cannot be used with --skeleton-cache or the time encoding.\n");
+                exit(EXIT_FAILURE);
+        }
+
+        if (clarg.sequential_enabled && clarg.encoding == ENCODING_TIME) {
+                fprintf(stderr, "Error: --sequential cannot be used with the time encoding.\n");
+                exit(EXIT_FAILURE);
+        }
+
+        if (clarg.command != NULL && fp != stdout) {
+                fprintf(stderr, "Error: -o and --exec cannot be used together.\n");
+                exit(EXIT_FAILURE);
+        }
+
+        if (clarg.polarity_enabled && clarg.format != FORMAT_CNF) {
+                fprintf(stderr, "Error: --polarity is only for the CNF format.\n");
+                exit(EXIT_FAILURE);
+        }
+        if (clarg.self_check_enabled && (clarg.format != FORMAT_CNF || clarg.command == NULL)) {
+                fprintf(stderr, "Error: --self-check is only for the CNF format with --exec.\n");
+                exit(EXIT_FAILURE);
+        }
+
+        bool found = false;
+        int status = generate(&clarg, in, fp, gz, &found);
+
+        // The same clues are solved again with the other of the full and polarity-aware encodings.
+        if (clarg.self_check_enabled) {
+                rewind(in);
+                clarg.polarity_enabled = !clarg.polarity_enabled;
+
+                bool found_again = false;
+                generate(&clarg, in, fp, gz, &found_again);
+
+                if (found != found_again) {
+                        const bool with = clarg.polarity_enabled ? found_again: found;
+                        fprintf(stderr, "Error: self-check failed: a model is %s with --polarity, but %s without it.\n",
+                                        with ? "found": "not found", with ? "not": "found");
+                        status = EXIT_FAILURE;
+                }
+        }
+
+        fclose(in);
+
+        return status;
+}
+
+// Generate constraints for the clue cells read from in, and write them to fp,
+// or pipe them into the solver if clarg->command is given, setting whether it found a model to found.
+// Return the exit status of the solver, or EXIT_SUCCESS.
+static int generate (const clarg_t *clarg, FILE *in, FILE *fp, bool gz, bool *found)
+{
+        solver_t solver;
+        if (clarg->command != NULL) {
+                start_solver(&solver, clarg->command);
+                fp = solver.in;
+        }
+
         data_t data;
-        init_data(&data, clarg.rank, clarg.bound);
-
-        fprintf(out, "; CSP constraints generated by scg_modeler\n");
-        fprintf(out, ";\n");
-        fprintf(out, "; [%8s] Naked  Singles\n",     clarg.NS_enabled ? "enabled": "disabled");
-        fprintf(out, "; [%8s] Hidden Singles\n",    clarg.HS_enabled ? "enabled": "disabled");
-        fprintf(out, "; [%8s] Locked Candidates\n", clarg.LC_enabled ? "enabled": "disabled");
-        fprintf(out, ";\n");
-        fprintf(out, "; rank  = %d\n",    data.rank);
-        fprintf(out, "; size  = %d\n",    data.size);
-        fprintf(out, "; max step = %d\n", data.bound);
+        // In sequential mode, the steps of a round are those of the strategies (see set_sequential()).
+        int round = 1;
+        if (clarg->sequential_enabled) {
+                const int nstrats = (clarg->NS_enabled ? 1: 0) + (clarg->HS_enabled ? 1: 0) + (clarg->LC_enabled ? 1: 0);
+                if (nstrats > 0) round = nstrats;
+        }
+
+        init_data(&data, clarg->rank, clarg->bound * round);
+        data.use_predicates = clarg->predicates_enabled;
+        data.encoding       = clarg->encoding;
+        data.skeleton       = clarg->skeleton_dir != NULL && false == clarg->estimate_enabled;
+        data.fused          = clarg->fused_enabled;
+        data.use_hints      = clarg->hints_enabled;
+        data.use_symmetry   = clarg->symmetry_enabled;
+        data.use_lex_leader = clarg->lex_leader_enabled;
+
+        // In the other formats than Sugar, constraints are translated through a filter sink before written to sink.
+        sink_t sink;
+        sink_t text;
+        cnf_t  cnf;
+        smt2_t smt2;
+        sink_t *out = &sink;
+        if (clarg->estimate_enabled) {
+                init_measuring_sink(out);
+        } else {
+                init_sink(out, fp, true, gz);
+        }
+
+        if (clarg->format == FORMAT_CNF) {
+                init_cnf(&cnf, &data, clarg->polarity_enabled);
+                init_filter_sink(&text, feed_sexp_reader, &(cnf.reader));
+                out = &text;
+        } else if (clarg->format == FORMAT_SMT2) {
+                init_smt2(&smt2, &data, out);
+                init_filter_sink(&text, feed_sexp_reader, &(smt2.reader));
+                out = &text;
+        }
+
+        sink_puts(out, "; CSP constraints generated by scg_modeler\n");
+        sink_puts(out, ";\n");
+        sink_printf(out, "; [%8s] Naked  Singles\n",     clarg->NS_enabled ? "enabled": "disabled");
+        sink_printf(out, "; [%8s] Hidden Singles\n",    clarg->HS_enabled ? "enabled": "disabled");
+        sink_printf(out, "; [%8s] Locked Candidates\n", clarg->LC_enabled ? "enabled": "disabled");
+        sink_puts(out, ";\n");
+        sink_printf(out, "; rank  = %d\n",    data.rank);
+        sink_printf(out, "; size  = %d\n",    data.size);
+        sink_printf(out, "; max step = %d\n", data.bound);
+        if (clarg->sequential_enabled) sink_printf(out, "; steps per round = %d\n", round);
 
         read_input(in, &data);
 
-        fprintf(out, "; number of clues = %d\n", data.nclues);
-        fprintf(out, "; clue cells:\n");
+        sink_printf(out, "; number of clues = %d\n", data.nclues);
+        sink_puts(out, "; clue cells:\n");
         print_cells(out, data.cs, data.nclues);
 
         // add rule and strategies
         add_sudoku_rule(&data); // mandatory
-        if (clarg.NS_enabled) add_naked_singles_strategy(&data);
-        if (clarg.HS_enabled) add_hidden_singles_strategy(&data);
-        if (clarg.LC_enabled) add_locked_candidates_strategy(&data);
+        if (clarg->NS_enabled) add_naked_singles_strategy(&data);
+        if (clarg->HS_enabled) add_hidden_singles_strategy(&data);
+        if (clarg->LC_enabled) add_locked_candidates_strategy(&data);
+        if (clarg->sequential_enabled) set_sequential(&data);
+        if (clarg->aggregates_enabled) add_aggregate_variables(&data); // after all strategies
+        if (clarg->final_flags_enabled) add_final_variables(&data);
+
+        if (clarg->prune_enabled) init_reach(&data);
+
+        names_t names;
+        if (clarg->names_file != NULL) {
+                init_names(&names, &data);
+                out->names = &names;
+
+                if (false == clarg->estimate_enabled) {
+                        FILE *map = fopen(clarg->names_file, "wb");
+                        if (map == NULL) {
+                                fprintf(stderr, "Error: cannot open %s\n", clarg->names_file);
+                                exit(EXIT_FAILURE);
+                        }
+                        fwrite_names(map, &names);
+                        fclose(map);
+                }
 
-        // variable declaration
-        fprint_decl_for_x(out, &data);
-        fprint_decl_for_y(out, &data);
-        fprint_decl_for_z(out, &data);
+                sink_printf(out, "; compact names: see %s\n", clarg->names_file);
+        }
 
-        // constraints for a general state transition framework
-        fprint_cons_for_init (out, &data);
-        fprint_cons_for_trans(out, &data);
-        fprint_cons_for_final(out, &data);
+        out->onehot = (data.encoding == ENCODING_ONEHOT);
+        out->clues  = &data;
+
+        toktab_t tokens;
+        init_toktab(&tokens, data.rank, data.bound, out->names, out->onehot, out->clues);
+        out->tokens = &tokens;
+
+        inliner_t inliner;
+        if (clarg->inline_limit > 0) init_inliner(&inliner, out, &data, clarg->inline_limit);
+
+        if (clarg->estimate_enabled) {
+                estimate_t est = {stdout, 0, 0};
+                fprintf(est.fp, "%-20s %12s %14s\n", "section", "count", "bytes");
+                measure_section(&est, out, "header");
+                fprint_constraints(out, &data, &est);
+                fprintf(est.fp, "%-20s %12lld %14lld\n", "total", out->nexprs, out->nbytes);
+        } else if (data.skeleton) {
+                FILE *skel = open_skeleton(clarg, &data, out);
+                splice_skeleton(out, skel, &data);
+                fclose(skel);
+        } else {
+                fprint_constraints(out, &data, NULL);
+        }
 
-        // constraints for particular strategies and rules
-        fprint_cons_for_strat(out, &data);
+        if (clarg->format == FORMAT_CNF) {
+                delete_sink(out);
+                out = &sink;
+                finish_cnf(&cnf, out);
+                delete_cnf(&cnf);
+        } else if (clarg->format == FORMAT_SMT2) {
+                delete_sink(out);
+                out = &sink;
+                finish_smt2(&smt2);
+                delete_smt2(&smt2);
+        }
+
+        delete_sink(out);
+
+        int status = EXIT_SUCCESS;
+        if (clarg->command != NULL) {
+                status = finish_solver(&solver); // the pipe fp is closed here.
+                *found = fprint_grid_from_log(stdout, &solver, &data, out->names, clarg->format);
+                delete_solver(&solver);
+        } else if (fp != stdout) {
+                fclose(fp);
+        }
 
         delete_data(&data);
+        if (clarg->inline_limit > 0) delete_inliner(&inliner);
+        delete_toktab(&tokens);
+        if (out->names != NULL) delete_names(&names);
 
-        fclose(in);
-        if (out != stdout) fclose(out);
+        if (clarg->stats_enabled) print_stats(stderr, out);
 
-        return 0;
+        return status;
 }
 
 static void usage (void)
 {
         fprintf(stderr, "Usage: $ scg_modeler option file\n");
-        fprintf(stderr, "-o file\tgenerate constraints to the specified file.\n");
+        fprintf(stderr, "-o file\tgenerate constraints to the specified file (compressed with gzip if it ends with .gz).\n");
         fprintf(stderr, "-N\tenable Naked  Singles\n");
         fprintf(stderr, "-H\tenable Hidden Singles\n");
         fprintf(stderr, "-L\tenable Locked Candidates\n");
         fprintf(stderr, "-r R\tRxR=N holds, where N is the number of rows.\n");
         fprintf(stderr, "-k K\tmaximum step size\n");
+        fprintf(stderr, "-s\tprint statistics of output to stderr\n");
+        fprintf(stderr, "--compact-names file\tprint short names of variables, and write their map to the specified file.\n");
+        fprintf(stderr, "--predicates\tprint definitions of auxiliary variables as calls of predicates, one per shape.\n");
+        fprintf(stderr, "--exec command\tpipe constraints into the stdin of the solver command, and decode its output like out2str.\n");
+        fprintf(stderr, "--format F\tprint constraints in the format F: sugar (default), cnf (DIMACS CNF, with the map of X variables in step 0 in comments), or smt2 (SMT-LIB2, QF_LIA).\n");
+        fprintf(stderr, "--encoding E\tencode X variables by E: int (default, x_i_j_k ranging from 0 to N), onehot (boolean p_i_j_n_k for x_i_j_k = n), or time (steps of placements and eliminations, only for Sugar).\n");
+        fprintf(stderr, "--prune\tfix X and Y variables, and omit Z variables, before the earliest steps reachable from the clue cells.\n");
+        fprintf(stderr, "--polarity\tdefine auxiliary variables of the CNF format only in the directions in which they occur.\n");
+        fprintf(stderr, "--self-check\tsolve the CNF format also with --polarity toggled by the solver of --exec, and fail if they disagree.\n");
+        fprintf(stderr, "--aggregates\tprint formulas over all cells of a row, column, or block but one by shared prefix and suffix aggregates.\n");
+        fprintf(stderr, "--inline L\tprint definitions of auxiliary variables of at most L literals in place of the variables, instead of declaring them.\n");
+        fprintf(stderr, "--fuse\tdefine one auxiliary variable per cell, number, and step for the Sudoku rule and for Hidden Singles, instead of one per kind or unit.\n");
+        fprintf(stderr, "--hints\tprint implied constraints for solvers: placements and eliminations persist, and clues in a row, column, or block are different.\n");
+        fprintf(stderr, "--symmetry\tbreak the symmetry of numbers: they first occur in increasing order in the clue cells.\n");
+        fprintf(stderr, "--lex-leader\tbreak the automorphisms of the arrangement of clue cells by lex-leader constraints on the numbers of clues.\n");
+        fprintf(stderr, "--final-flags\tprint the constraints for final states by flags of stable and complete steps, defined by indicators of unchanged cells.\n");
+        fprintf(stderr, "--sequential\tapply the strategies one per step in rounds of Naked Singles, Hidden Singles, and Locked Candidates, each reading the state left by the previous one, where K is the number of rounds.\n");
+        fprintf(stderr, "--estimate\tprint the numbers of constraints and bytes of each section instead of constraints (for X, Y, Z, the numbers of variables).\n");
+        fprintf(stderr, "--skeleton-cache dir\tsplice the clues into the skeleton of constraints cached in the specified directory, generating it if missing.\n");
         fprintf(stderr, "-h\tthis message\n");
         fprintf(stderr, "\n");
         fprintf(stderr, "[Author] Takahisa Toda <todat@acm.org>\n");
@@ -163,11 +606,165 @@ static void usage (void)
         fprintf(stderr, "http://www.disc.lab.uec.ac.jp/toda/index-en.html\n");
 }
 
-static void print_cells (FILE *out, const cell_t *q, int len)
+static void print_cells (sink_t *out, const cell_t *q, int len)
 {
 
         for (int pos = 0; pos < len; pos++) {
-                fprintf(out, "; %d %d\n", q[pos].I + 1, q[pos].J + 1);
+                sink_printf(out, "; %d %d\n", q[pos].I + 1, q[pos].J + 1);
+        }
+}
+
+static void print_stats (FILE *out, const sink_t *sink)
+{
+        fprintf(out, "bytes generated = %lld\n", sink->nbytes);
+        fprintf(out, "bytes written   = %lld\n", sink->nwritten);
+        fprintf(out, "fill  time  [s] = %.3f\n", sink->fill_time);
+        fprintf(out, "write time  [s] = %.3f\n", sink->write_time);
+        fprintf(out, "wait  time  [s] = %.3f\n", sink->wait_time);
+}
+
+static bool has_suffix (const char *s, const char *suffix)
+{
+        const size_t len = strlen(s);
+        const size_t n   = strlen(suffix);
+
+        return len >= n && strcmp(s + len - n, suffix) == 0;
+}
+
+// If est is not NULL, the size of each section is reported.
+static void fprint_constraints (sink_t *out, data_t *data, estimate_t *est)
+{
+        if (data->encoding == ENCODING_TIME) {
+                fprint_decl_for_x(out, data);
+                measure_section(est, out, "X variables");
+                fprint_decl_for_times(out, data);
+                measure_section(est, out, "time variables");
+
+                fprint_cons_for_init(out, data);
+                measure_section(est, out, "initial states");
+                fprint_cons_for_times(out, data);
+                measure_section(est, out, "times");
+                fprint_cons_for_timed_final(out, data);
+                measure_section(est, out, "final states");
+                return;
+        }
+
+        // variable declaration
+        fprint_decl_for_x(out, data);
+        measure_section(est, out, "X variables");
+        fprint_decl_for_y(out, data);
+        measure_section(est, out, "Y variables");
+        fprint_decl_for_z(out, data);
+        measure_section(est, out, "Z variables");
+        fprint_decl_for_predicates(out, data);
+        measure_section(est, out, "predicates");
+
+        // constraints for a general state transition framework
+        fprint_cons_for_init (out, data);
+        measure_section(est, out, "initial states");
+        fprint_cons_for_trans(out, data);
+        measure_section(est, out, "transitions");
+        fprint_cons_for_final(out, data);
+        measure_section(est, out, "final states");
+        fprint_cons_for_hints(out, data);
+        measure_section(est, out, "hints");
+        fprint_cons_for_symmetry(out, data);
+        measure_section(est, out, "symmetry");
+        fprint_cons_for_lex_leader(out, data);
+        measure_section(est, out, "lex-leader");
+
+        // constraints for particular strategies and rules
+        if (est == NULL) {
+                fprint_cons_for_strat(out, data);
+                return;
+        }
+
+        for (int pos = 0; pos < data->nstrats; pos++) {
+                if (data->strat[pos].fprint_cons_for_z != NULL) {
+                        data->strat[pos].fprint_cons_for_z(out, data);
+                        measure_section(est, out, name_of_strategy(data->strat[pos].tag));
+                }
         }
 }
 
+// Print out the numbers of expressions and bytes printed since the last call.
+static void measure_section (estimate_t *est, sink_t *out, const char *name)
+{
+        if (est == NULL) return;
+
+        fprintf(est->fp, "%-20s %12lld %14lld\n", name, out->nexprs - est->nexprs, out->nbytes - est->nbytes);
+
+        est->nexprs = out->nexprs;
+        est->nbytes = out->nbytes;
+}
+
+static const char *name_of_strategy (stag_t tag)
+{
+        switch (tag) {
+                case tag_SR: return "Sudoku rule";
+                case tag_NS: return "Naked Singles";
+                case tag_HS: return "Hidden Singles";
+                case tag_LC: return "Locked Candidates";
+                case tag_AG: return "Aggregates";
+                case tag_FS: return "Final flags";
+                default:
+                        assert(0);
+                        return "unknown";
+        }
+}
+
+// Open the skeleton for the current options in the cache directory.
+// If it does not exist yet, it is generated once and then shared by all arrangements of clues.
+// It is written to a temporary file and renamed, so that concurrent runs never read a partial skeleton.
+static FILE *open_skeleton (const clarg_t *clarg, data_t *data, const sink_t *out)
+{
+        const size_t len = strlen(clarg->skeleton_dir) + 128;
+        char path[len];
+        char temp[len];
+
+        snprintf(path, len, "%s/scg-v%d-r%d-k%d-%s%s%s%s%s%s%s%s%s.skel",
+                        clarg->skeleton_dir, SCG_SKELETON_VERSION, data->rank, data->bound,
+                        clarg->NS_enabled ? "N": "",
+                        clarg->HS_enabled ? "H": "",
+                        clarg->LC_enabled ? "L": "",
+                        clarg->predicates_enabled ? "P": "",
+                        clarg->names_file != NULL ? "C": "",
+                        clarg->encoding == ENCODING_ONEHOT ? "O": "",
+                        clarg->encoding == ENCODING_TIME   ? "T": "",
+                        clarg->fused_enabled ? "F": "",
+                        clarg->sequential_enabled ? "S": "");
+
+        FILE *skel = fopen(path, "rb");
+        if (skel != NULL) return skel;
+
+        snprintf(temp, len, "%s.%ld.tmp", path, (long)getpid());
+        FILE *fp = fopen(temp, "wb");
+        if (fp == NULL) {
+                fprintf(stderr, "Error: cannot open %s\n", temp);
+                exit(EXIT_FAILURE);
+        }
+
+        sink_t sink;
+        init_sink(&sink, fp, true, false);
+        sink.tokens = out->tokens;
+        sink.names  = out->names;
+        sink.onehot = out->onehot;
+        sink.clues  = out->clues;
+
+        fprint_constraints(&sink, data, NULL);
+
+        delete_sink(&sink);
+        if (fclose(fp) != 0 || rename(temp, path) != 0) {
+                fprintf(stderr, "Error: cannot write %s\n", path);
+                remove(temp);
+                exit(EXIT_FAILURE);
+        }
+
+        skel = fopen(path, "rb");
+        if (skel == NULL) {
+                fprintf(stderr, "Error: cannot open %s\n", path);
+                exit(EXIT_FAILURE);
+        }
+
+        return skel;
+}
@@ -1,10 +1,22 @@
+#define _POSIX_C_SOURCE 200809L // for clock_gettime()
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stdint.h>
 #include <assert.h>
+#include <time.h>
+#include <pthread.h>
+#include <zlib.h>
 
 #include "scg_modeler.h"
 #include "scg_assert.h"
+#include "scg_reach.h"
+#include "scg_aggregate.h"
+#include "scg_final.h"
+#include "scg_symmetry.h"
 
 static void init_idmgr (idmgr_t *p,
         const int pid[], int len,
@@ -14,6 +26,32 @@ static void init_idmgr (idmgr_t *p,
         bool (*accepted)(const int *, const data_t *));
 
 static void  delete_idmgr (idmgr_t *p);
+static void  renumber_ids (idmgr_t *p, data_t *data);
+static bool  accepted_in_skeleton (const idmgr_t *p, const int *buf, data_t *data);
+static int   slot_of_values  (const int *value, const param_t *p, const idmgr_t *mgr);
+static void  values_of_slot  (int slot, int *value, const param_t *p, const idmgr_t *mgr);
+
+static void format_literal (sink_t *out, char symb, int i, int j, int n, int k);
+static void build_slice    (toktab_t *tab, int k);
+static int  token_index    (const toktab_t *tab, char symb, int i, int j, int n);
+
+static void set_lit (lit_t *lit, char symb, int i, int j, int n, int k);
+static void fprint_call_of_predicate (sink_t *out, const data_t *data, int index, const char *connective, const runarg_t *arg);
+static void fprint_definition (sink_t *out, const data_t *data, int index, const char *connective, const runarg_t *args, int nargs);
+static void fprint_body      (sink_t *out, const data_t *data, const char *connective, const runarg_t *args, int nargs);
+static int  union_of_literals (const data_t *data, const runarg_t *arg, lit_t *lits, int len);
+static bool skip_definition  (sink_t *out, const data_t *data, int index, const char *connective, const runarg_t *args, int nargs);
+static bool is_inlinable     (const data_t *data, int index);
+static stag_t tag_of_z       (const data_t *data, int index);
+
+static void fprint_trans_by_strats (sink_t *out, const data_t *data, char symb);
+static void fprint_at_most_one (sink_t *out, const data_t *data, int i, int j, int k);
+
+static void fprint_guard    (sink_t *out, char type, int cell);
+static bool fprint_substituted (sink_t *out, char symb, int i, int j, int n, int *k);
+static void fprint_name_of_var (sink_t *out, char symb, int i, int j, int n, int k);
+static bool guard_of_z      (const data_t *data, int index, int *cell);
+static bool guard_holds     (const char *mark, const bool *clue, int ncells);
 
 
 void read_input (FILE *in, data_t *data)
@@ -85,6 +123,457 @@ for (int k = 1; k < nclues; k++) {
 	}
 
 	data->nclues = count; 
+
+	for (int pos = 0; pos < count; pos++) {
+		data->clue[cs[pos].I * size + cs[pos].J] = true;
+	}
+
+	if (data->use_lex_leader) find_automorphisms(data);
+}
+
+// Two-digit lookup table for sink_putint(): the pair for d (0 <= d < 100)
+// is stored at digit_pairs[2*d] and digit_pairs[2*d+1].
+static const char digit_pairs[201] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+static double elapsed_since (const struct timespec *start);
+static void  *run_writer (void *arg);
+static bool   write_block (sink_t *out, const char *buf, size_t len);
+static void   grow_sink   (sink_t *out, size_t len);
+static int    width_of_int (int value);
+static bool   is_memory_sink (const sink_t *out);
+
+// If threaded is true, a background thread writes filled buffers to fp
+// while the caller goes on filling another buffer.
+// If compressed is true, each filled buffer is written as an independent gzip member,
+// so that the output can be decompressed by gzip as a whole or member by member.
+// If fp is NULL, the sink only keeps all bytes in its buffer (memory sink).
+void init_sink (sink_t *out, FILE *fp, bool threaded, bool compressed)
+{
+	assert(out != NULL);
+	assert(fp  != NULL || (threaded == false && compressed == false));
+
+	const size_t cap = (fp == NULL ? BUFSIZ: SINK_BUFSIZE);
+
+	const int nbufs = (threaded ? SINK_NBUFS: 1);
+	for (int pos = 0; pos < nbufs; pos++) {
+		out->ring[pos] = (char*)malloc(cap);
+		if (out->ring[pos] == NULL) {
+			fprintf(stderr, "ERROR: Memory allocation failed.\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	out->fp     = fp;
+	out->buf    = out->ring[0];
+	out->len    = 0;
+	out->cap    = cap;
+	out->nbytes = 0;
+	out->nwritten = 0;
+	out->tokens = NULL;
+	out->names  = NULL;
+	out->onehot = false;
+	out->clues  = NULL;
+	out->inliner = NULL;
+
+	out->consume     = NULL;
+	out->consume_arg = NULL;
+
+	out->measuring = false;
+	out->nexprs    = 0;
+
+	out->nbufs   = nbufs;
+	out->head    = 0;
+	out->nfull   = 0;
+	out->closing = false;
+	out->failed  = false;
+
+	out->fill_time  = 0.0;
+	out->wait_time  = 0.0;
+	out->write_time = 0.0;
+	clock_gettime(CLOCK_MONOTONIC, &(out->start));
+
+	out->zbuf = NULL;
+	if (compressed) {
+		z_stream *zs = &(out->zs);
+		zs->zalloc = Z_NULL;
+		zs->zfree  = Z_NULL;
+		zs->opaque = Z_NULL;
+
+		// 15 + 16: maximum window with a gzip header and trailer.
+		if (deflateInit2(zs, SINK_GZIP_LEVEL, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+			fprintf(stderr, "ERROR: Cannot initialize compression.\n");
+			exit(EXIT_FAILURE);
+		}
+
+		out->zcap = deflateBound(zs, cap);
+		out->zbuf = (unsigned char*)malloc(out->zcap);
+		if (out->zbuf == NULL) {
+			fprintf(stderr, "ERROR: Memory allocation failed.\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	out->threaded = false;
+	if (threaded) {
+		pthread_mutex_init(&(out->lock), NULL);
+		pthread_cond_init (&(out->cond), NULL);
+
+		if (pthread_create(&(out->writer), NULL, run_writer, out) == 0) {
+			out->threaded = true;
+		} else {
+			// fall back to writing in the calling thread.
+			pthread_mutex_destroy(&(out->lock));
+			pthread_cond_destroy (&(out->cond));
+		}
+	}
+}
+
+// A measuring sink renders nothing: the primitives only add up the widths of strings, integers, and tokens,
+// and the ends of expressions are counted by sink_endexpr(),
+// so that the size of constraints is obtained by the same loops and accepted() predicates as generation.
+void init_measuring_sink (sink_t *out)
+{
+	init_sink(out, NULL, false, false);
+	out->measuring = true;
+}
+
+// A filter sink hands flushed bytes over to consume() instead of writing them,
+// e.g., to translate constraints into another format while they are generated.
+void init_filter_sink (sink_t *out, void (*consume) (void *, const char *, size_t), void *arg)
+{
+	init_sink(out, NULL, false, false);
+	out->consume     = consume;
+	out->consume_arg = arg;
+}
+
+// Flush the remaining bytes, wait for the writer, and release the buffers
+// (the destination is not closed).
+void delete_sink (sink_t *out)
+{
+	assert(out->buf != NULL);
+
+	if (out->consume != NULL) {
+		flush_sink(out);
+		out->fill_time = elapsed_since(&(out->start));
+	}
+
+	if (out->fp == NULL) {
+		free(out->buf);
+		out->buf = out->ring[0] = NULL;
+		return;
+	}
+
+	flush_sink(out);
+
+	const bool threaded = out->threaded;
+	if (threaded) {
+		pthread_mutex_lock(&(out->lock));
+		out->closing = true;
+		pthread_cond_broadcast(&(out->cond));
+		pthread_mutex_unlock(&(out->lock));
+
+		pthread_join(out->writer, NULL);
+		pthread_mutex_destroy(&(out->lock));
+		pthread_cond_destroy (&(out->cond));
+		out->threaded = false;
+	}
+
+	if (out->failed || fflush(out->fp) != 0) {
+		fprintf(stderr, "ERROR: Cannot write constraints.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	for (int pos = 0; pos < out->nbufs; pos++) {
+		free(out->ring[pos]);
+		out->ring[pos] = NULL;
+	}
+	out->buf = NULL;
+
+	if (out->zbuf != NULL) {
+		deflateEnd(&(out->zs));
+		free(out->zbuf);
+		out->zbuf = NULL;
+	}
+
+	out->fill_time = elapsed_since(&(out->start)) - out->wait_time;
+	if (false == threaded) {
+		out->fill_time -= out->write_time; // filling and writing are not overlapped.
+	}
+}
+
+// Hand the filled buffer over to the writer and continue with an empty one.
+// Without a writer thread, the buffer is written immediately.
+void flush_sink (sink_t *out)
+{
+	if (out->consume != NULL) {
+		out->consume(out->consume_arg, out->buf, out->len);
+		out->nbytes += out->len;
+		out->len     = 0;
+		return;
+	}
+
+	if (out->len == 0 || out->fp == NULL) return;
+
+	if (false == out->threaded) {
+		out->failed = (false == write_block(out, out->buf, out->len));
+		if (out->failed) {
+			fprintf(stderr, "ERROR: Cannot write constraints.\n");
+			exit(EXIT_FAILURE);
+		}
+		out->nbytes += out->len;
+		out->len     = 0;
+		return;
+	}
+
+	pthread_mutex_lock(&(out->lock));
+
+	out->ring_len[(out->head + out->nfull) % out->nbufs] = out->len;
+	out->nfull++;
+	pthread_cond_broadcast(&(out->cond));
+
+	// memory is bounded: wait until the writer returns some buffer.
+	if (out->nfull == out->nbufs && false == out->failed) {
+		struct timespec start;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+
+		while (out->nfull == out->nbufs && false == out->failed) {
+			pthread_cond_wait(&(out->cond), &(out->lock));
+		}
+
+		out->wait_time += elapsed_since(&start);
+	}
+
+	const bool failed = out->failed;
+	out->buf = out->ring[(out->head + out->nfull) % out->nbufs];
+
+	pthread_mutex_unlock(&(out->lock));
+
+	if (failed) {
+		fprintf(stderr, "ERROR: Cannot write constraints.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	out->nbytes += out->len;
+	out->len     = 0;
+}
+
+// Writer thread: drain filled buffers in order until the sink is closed.
+// After a write error, the remaining buffers are discarded and the failure
+// is reported to the generator at its next flush.
+static void *run_writer (void *arg)
+{
+	sink_t *out = (sink_t*)arg;
+
+	pthread_mutex_lock(&(out->lock));
+
+	for (;;) {
+		while (out->nfull == 0 && false == out->closing) {
+			pthread_cond_wait(&(out->cond), &(out->lock));
+		}
+		if (out->nfull == 0) break; // closing
+
+		const char  *buf = out->ring[out->head];
+		const size_t len = out->ring_len[out->head];
+		bool failed = out->failed;
+
+		pthread_mutex_unlock(&(out->lock));
+		if (false == failed) failed = (false == write_block(out, buf, len));
+		pthread_mutex_lock(&(out->lock));
+
+		out->failed = failed;
+		out->head = (out->head + 1) % out->nbufs;
+		out->nfull--;
+		pthread_cond_broadcast(&(out->cond));
+	}
+
+	pthread_mutex_unlock(&(out->lock));
+
+	return NULL;
+}
+
+// Note: in threaded mode, called only by the writer thread.
+static bool write_block (sink_t *out, const char *buf, size_t len)
+{
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	if (out->zbuf != NULL) { // compress the block into a gzip member of its own.
+		z_stream *zs = &(out->zs);
+
+		if (deflateReset(zs) != Z_OK) return false;
+
+		zs->next_in   = (unsigned char*)buf;
+		zs->avail_in  = (unsigned int)len;
+		zs->next_out  = out->zbuf;
+		zs->avail_out = (unsigned int)out->zcap;
+
+		// never fails to finish because zcap is the upper bound of compressed blocks.
+		if (deflate(zs, Z_FINISH) != Z_STREAM_END) return false;
+
+		buf = (const char*)out->zbuf;
+		len = out->zcap - zs->avail_out;
+	}
+
+	const bool done = (fwrite(buf, 1, len, out->fp) == len);
+	out->nwritten += len;
+
+	out->write_time += elapsed_since(&start);
+
+	return done;
+}
+
+static double elapsed_since (const struct timespec *start)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (double)(now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) * 1e-9;
+}
+
+void sink_write (sink_t *out, const char *s, size_t n)
+{
+	if (out->measuring) {
+		out->nbytes += n;
+		return;
+	}
+
+	if (is_memory_sink(out) && out->len + n > out->cap) {
+		grow_sink(out, out->len + n);
+	}
+
+	while (out->len + n > out->cap) {
+		const size_t room = out->cap - out->len;
+
+		memcpy(out->buf + out->len, s, room);
+		out->len += room;
+		flush_sink(out);
+
+		s = s + room;
+		n = n - room;
+	}
+
+	memcpy(out->buf + out->len, s, n);
+	out->len += n;
+}
+
+// Whether all bytes are kept in the buffer, which grows as needed.
+static bool is_memory_sink (const sink_t *out)
+{
+	return out->fp == NULL && false == out->measuring && out->consume == NULL;
+}
+
+// Enlarge the buffer of a memory sink so that it can hold at least len bytes.
+static void grow_sink (sink_t *out, size_t len)
+{
+	assert(out->fp == NULL);
+
+	size_t cap = out->cap;
+	while (cap < len) cap = cap * 2;
+
+	char *buf = (char*)realloc(out->buf, cap);
+	if (buf == NULL) {
+		fprintf(stderr, "ERROR: Memory allocation failed.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	out->buf = out->ring[0] = buf;
+	out->cap = cap;
+}
+
+void sink_puts (sink_t *out, const char *s)
+{
+	sink_write(out, s, strlen(s));
+}
+
+void sink_putc (sink_t *out, char c)
+{
+	if (out->measuring) {
+		out->nbytes++;
+		return;
+	}
+
+	if (out->len == out->cap) {
+		if (is_memory_sink(out)) grow_sink(out, out->len + 1);
+		else                 flush_sink(out);
+	}
+
+	out->buf[out->len++] = c;
+}
+
+// Print out a decimal integer without parsing a format string.
+void sink_putint (sink_t *out, int value)
+{
+	if (out->measuring) {
+		out->nbytes += width_of_int(value);
+		return;
+	}
+
+	char tmp[16];
+	char *const end = tmp + sizeof(tmp);
+	char *s = end;
+
+	unsigned int v = (value < 0 ? 0u - (unsigned int)value: (unsigned int)value);
+
+	while (v >= 100) {
+		const unsigned int d = (v % 100) * 2;
+		v = v / 100;
+		*--s = digit_pairs[d + 1];
+		*--s = digit_pairs[d];
+	}
+
+	if (v >= 10) {
+		*--s = digit_pairs[v * 2 + 1];
+		*--s = digit_pairs[v * 2];
+	} else {
+		*--s = (char)('0' + v);
+	}
+
+	if (value < 0) *--s = '-';
+
+	sink_write(out, s, (size_t)(end - s));
+}
+
+// Only for infrequent output such as comments: use sink_puts() and sink_putint() in loops.
+void sink_printf (sink_t *out, const char *format, ...)
+{
+	char tmp[BUFSIZ];
+
+	va_list ap;
+	va_start(ap, format);
+	const int n = vsnprintf(tmp, sizeof(tmp), format, ap);
+	va_end(ap);
+
+	assert(0 <= n && n < (int)sizeof(tmp));
+	sink_write(out, tmp, (size_t)n);
+}
+
+// Print out s, which ends a declaration or a constraint, e.g., ")\n", and count the expression
+// (see init_measuring_sink()). An expression spanning lines is counted once.
+void sink_endexpr (sink_t *out, const char *s)
+{
+	sink_puts(out, s);
+	out->nexprs++;
+}
+
+// Number of characters of a decimal integer printed by sink_putint().
+static int width_of_int (int value)
+{
+	unsigned int v = (value < 0 ? 0u - (unsigned int)value: (unsigned int)value);
+
+	int width = (value < 0 ? 2: 1);
+	for (; v >= 10; v = v / 10) width++;
+
+	return width;
 }
 
 void init_data (data_t *data, int rank, int bound)
@@ -104,6 +593,30 @@ void init_data (data_t *data, int rank, int bound)
 
 	data->nclues = 0;
 
+	data->clue = (bool*)malloc(sizeof(bool) * size * size);
+	if (data->clue == NULL) {
+		fprintf(stderr, "ERROR: Memory allocation failed.\n");
+		exit(EXIT_FAILURE);
+	}
+	for (int c = 0; c < size * size; c++) {
+		data->clue[c] = false;
+	}
+
+	data->first_placed = NULL;
+	data->first_elim   = NULL;
+
+	data->use_predicates = false;
+	data->use_hints      = false;
+	data->use_symmetry   = false;
+	data->use_lex_leader = false;
+
+	data->generators  = NULL;
+	data->ngenerators = 0;
+	data->encoding = ENCODING_INT;
+	data->skeleton = false;
+	data->fused    = false;
+	data->round    = 1;
+
 	param_t *p = (param_t *)malloc(sizeof(param_t));
 	if (p == NULL) {
 		fprintf(stderr, "ERROR: Memory allocation failed.\n");
@@ -146,6 +659,17 @@ void delete_data (data_t *data)
 	free(data->cs);
 	data->cs = NULL;
 
+	free(data->clue);
+	data->clue = NULL;
+
+	free(data->first_placed);
+	free(data->first_elim);
+	data->first_placed = NULL;
+	data->first_elim   = NULL;
+
+	free(data->generators);
+	data->generators = NULL;
+
 	free(data->p);
 	data->p = NULL;
 }
@@ -157,9 +681,9 @@ void add_strategy (data_t *data,
 			void (*encoder) (const int *, int *, int, const param_t *, const idmgr_t *),
 			void (*decoder) (int,         int *, int, const param_t *, const idmgr_t *),
 			bool (*accepted)(const int *, const data_t *),
-			void (*fprint_literals_for_x) (FILE *, const data_t *),
-			void (*fprint_literals_for_y) (FILE *, const data_t *),
-			void (*fprint_cons_for_z    ) (FILE *, data_t *))
+			void (*fprint_literals_for_x) (sink_t *, const data_t *),
+			void (*fprint_literals_for_y) (sink_t *, const data_t *),
+			void (*fprint_cons_for_z    ) (sink_t *, data_t *))
 {
 	assert(data != NULL);
 	assert(pid  != NULL);
@@ -194,6 +718,8 @@ void add_strategy (data_t *data,
 	
 	data->nstrats++;
 
+	renumber_ids(mgr, data);
+
 	assert_encoder_decoder(mgr, data);
 }
 
@@ -226,12 +752,71 @@ bool accepted_general (const int *buf, const idmgr_t *mgr, const data_t *data)
 	cell_t q = cell_at(buf[pos_I], buf[pos_J], rank);
 
 	if (p->min[pid_K] < buf[pos_K]) {
+		// In skeleton mode, such a variable is printed only in the non-clue case (see guard_of_z()).
+		if (data->skeleton) return true;
 		return false == is_clue_cell(q, data->cs, data->nclues);
 	}
 
 	return true;
 }
 
+// In sequential mode, a step of the strategies is split into a round of steps, one per strategy,
+// which are applied in the order of Naked Singles, Hidden Singles, and Locked Candidates.
+// Each of them reads the state of the previous step, in which the Sudoku rule has been applied
+// to the numbers placed by the previous strategies, as in solve() of check_solvable.
+// The bound must be given in steps, i.e., a multiple of the number of strategies.
+void set_sequential (data_t *data)
+{
+	const stag_t order[] = {tag_NS, tag_HS, tag_LC};
+
+	int len = 0;
+	for (int s = 0; s < (int)(sizeof(order) / sizeof(order[0])); s++) {
+		if (get_idmgr(order[s], data) != NULL) data->phase[len++] = order[s];
+	}
+
+	data->round = (len > 0 ? len: 1);
+	assert(data->bound % data->round == 0);
+
+	// The strategies have been numbered as if they were applied in all steps,
+	// so number them again to skip the steps to which they are no longer applied (see applies_in_step()).
+	data->nissued = 0;
+	for (int s = 0; s < data->nstrats; s++) {
+		idmgr_t *mgr = data->strat[s].idmgr;
+
+		free(mgr->id_of_slot);
+		free(mgr->slot_of_id);
+		mgr->first    = data->nissued;
+		mgr->total    = mgr->nslots;
+		data->nissued = data->nissued + mgr->nslots;
+
+		renumber_ids(mgr, data);
+
+		assert_encoder_decoder(mgr, data);
+	}
+}
+
+// Whether the strategy of the tag is applied in step k, which is always so except in sequential mode,
+// where no strategy is applied in the initial step.
+// The Sudoku rule is applied in all steps but those of strategies placing no number,
+// in which it has nothing to eliminate that has not been eliminated in the previous step.
+bool applies_in_step (const data_t *data, stag_t tag, int k)
+{
+	if (data->round == 1) return true;
+
+	const int min = data->p->min[data->pid_K];
+	if (k == min) return tag == tag_SR;
+
+	const stag_t cur = data->phase[(k - min - 1) % data->round];
+	if (tag != tag_SR) return cur == tag;
+
+	for (int pos = 0; pos < data->nstrats; pos++) {
+		if (data->strat[pos].tag == cur) return data->strat[pos].fprint_literals_for_x != NULL;
+	}
+
+	assert(0);
+	return true;
+}
+
 // Get the idmgr of a specified strategy.
 const idmgr_t *get_idmgr(stag_t tag, const data_t *data)
 {
@@ -270,11 +855,14 @@ static void init_idmgr (idmgr_t *p,
 
 	p->first    = *nissued;
 	p->total    = total;
+	p->nslots   = total;
+	p->id_of_slot = NULL;
+	p->slot_of_id = NULL;
 	p->encoder  = encoder;
 	p->decoder  = decoder;
 	p->accepted = accepted;
 
-	*nissued   = *nissued + total; // issue ids in a lump.
+	*nissued   = *nissued + total; // issue ids in a lump, and give back the unused ones later (see renumber_ids()).
 }
 
 static void delete_idmgr (idmgr_t *p)
@@ -283,6 +871,61 @@ static void delete_idmgr (idmgr_t *p)
 
 	free(p->pid);
 	p->pid = NULL;
+
+	free(p->id_of_slot);
+	free(p->slot_of_id);
+	p->id_of_slot = NULL;
+	p->slot_of_id = NULL;
+}
+
+// Number only the combinations of parameter values accepted by the strategy consecutively from p->first,
+// and give back the rest of the ids issued in a lump, so that the indices of Z variables are dense.
+// Combinations are accepted as in skeleton mode, i.e., independently of clues,
+// so that the indices are the same with and without skeletons (see accepted_general()).
+// This must be called after the strategy is added, because accepted() may refer to its id manager.
+static void renumber_ids (idmgr_t *p, data_t *data)
+{
+	const int nslots = p->nslots;
+
+	p->id_of_slot = (int*)malloc(sizeof(int) * nslots);
+	p->slot_of_id = (int*)malloc(sizeof(int) * nslots);
+	if (p->id_of_slot == NULL || p->slot_of_id == NULL) {
+		fprintf(stderr, "ERROR: Memory allocation failed.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	int buf[p->len];
+	int nids = 0;
+
+	for (int slot = 0; slot < nslots; slot++) {
+		values_of_slot(slot, buf, data->p, p);
+
+		if (true == accepted_in_skeleton(p, buf, data)) {
+			p->id_of_slot[slot] = nids;
+			p->slot_of_id[nids] = slot;
+			nids++;
+		} else {
+			p->id_of_slot[slot] = -1;
+		}
+	}
+
+	assert(data->nissued == p->first + p->total); // no strategy has been added since.
+
+	p->total      = nids;
+	data->nissued = p->first + nids;
+}
+
+// Whether the combination of parameter values is accepted in skeleton mode, i.e., has been numbered by renumber_ids().
+static bool accepted_in_skeleton (const idmgr_t *p, const int *buf, data_t *data)
+{
+	const bool skeleton = data->skeleton;
+	data->skeleton = true;
+
+	const bool accepted = p->accepted(buf, data);
+
+	data->skeleton = skeleton;
+
+	return accepted;
 }
 
 // Copy the current values of parameters (managed by mgr) to the array "to" ,
@@ -324,12 +967,31 @@ int pos_of_pid (int pid, const idmgr_t *mgr)
 }
 
 // Encode the combination of parameter values into a single integer,
-// where value[pos] must be set the value of the parameter of id  mgr->pid[pos] in advance.
+// where value[pos] must be set the value of the parameter of id  mgr->pid[pos] in advance,
+// and the combination must be accepted (see renumber_ids()).
 void default_encoder (const int *value, int *index, int rank, const param_t *p, const idmgr_t *mgr)
 {
 	assert(value != NULL);
 	assert(index != NULL);
 
+	const int slot = slot_of_values(value, p, mgr);
+
+	assert(mgr->id_of_slot[slot] >= 0);
+
+	*index = mgr->id_of_slot[slot] + (mgr->first);
+}
+
+void default_decoder (int index, int *value, int rank, const param_t *p, const idmgr_t *mgr)
+{
+	assert(value != NULL);
+	assert(mgr->first <= index && index < mgr->first + mgr->total);
+
+	values_of_slot(mgr->slot_of_id[index - (mgr->first)], value, p, mgr);
+}
+
+// Number all combinations of parameter values in lexicographic order of mgr->pid.
+static int slot_of_values (const int *value, const param_t *p, const idmgr_t *mgr)
+{
 	int diff = 0;
 
 	const int len = mgr->len;
@@ -341,14 +1003,12 @@ void default_encoder (const int *value, int *index, int rank, const param_t *p,
 		diff = diff + (value[pos]  - p->min[pid]);
 	}
 
-	*index = diff + (mgr->first);
+	return diff;
 }
 
-void default_decoder (int index, int *value, int rank, const param_t *p, const idmgr_t *mgr)
+static void values_of_slot (int slot, int *value, const param_t *p, const idmgr_t *mgr)
 {
-	assert(value != NULL);
-
-	int diff = index - (mgr->first);
+	int diff = slot;
 
 	const int len = mgr->len;
 
@@ -580,49 +1240,250 @@ for (int pos = 1; pos < n; pos++) {
 	return false;
 }
 
-// Get the cell (i,j)
-cell_t cell_at (int i, int j, int r)
+// Cases of a cell q, in which different constraints are printed,
+// to be iterated as follows:
+//
+// for (int c = first_case(out, data, q); c != CASE_NONE; c = next_case(out, data, q, c)) ...
+//
+// Usually, only the case of whether q is a clue cell is iterated.
+// In skeleton mode, both cases are iterated, and the constraints of each case
+// are printed under the guard of the case, which are selected by splice_skeleton().
+int first_case (sink_t *out, const data_t *data, cell_t q)
 {
-	cell_t q;
-	q.I = i;
-	q.J = j;
+	if (data->skeleton) {
+		fprint_guard(out, SKEL_CLUE, q.I * data->size + q.J);
+		return CASE_CLUE;
+	}
 
-	return q;	
+	return is_clue_cell(q, data->cs, data->nclues) ? CASE_CLUE: CASE_NONCLUE;
 }
 
-// Get the m-th cell in the n-th block.
-cell_t cell_in_block (int m, int n, int r)
+int next_case (sink_t *out, const data_t *data, cell_t q, int c)
 {
-	cell_t q;
-	q.I = (n / r) * r + (m / r);
-	q.J = (n % r) * r + (m % r);
+	if (false == data->skeleton) return CASE_NONE;
 
-	return q;
+	if (c == CASE_CLUE) {
+		fprint_guard(out, SKEL_NONCLUE, q.I * data->size + q.J);
+		return CASE_NONCLUE;
+	}
+
+	fprint_guard(out, SKEL_ALWAYS, -1);
+	return CASE_NONE;
 }
 
-// Get (the index of ) the block to which the cell q belongs.
-int ownerblock (cell_t q, int r)
+// A guard is a mark in a skeleton, which is never contained in constraints:
+// SKEL_MARK type cell SKEL_MARK_END,
+// where cell is the index i*size+j of a cell (i,j) in decimal, omitted for SKEL_ALWAYS.
+// The following bytes are printed only if the guard holds for the clues.
+static void fprint_guard (sink_t *out, char type, int cell)
 {
-	return (q.I / r) * r + (q.J / r);
+	sink_putc(out, SKEL_MARK);
+	sink_putc(out, type);
+	if (cell >= 0) sink_putint(out, cell);
+	sink_putc(out, SKEL_MARK_END);
 }
 
-
-// Answer whether the cell q is in the n-th block.
-bool is_in_block (cell_t q, int n, int r)
+// Whether z_index must be printed under the guard of the non-clue case in skeleton mode.
+// If so, the index of its cell is stored in cell (see accepted_general()).
+static bool guard_of_z (const data_t *data, int index, int *cell)
 {
-	const int owener = ownerblock(q, r);
+	if (false == data->skeleton) return false;
 
-	return owener == n;
-}
+	const param_t *p = data->p;
 
-// For 1 <= n <= size,
+	for (int pos = 0; pos < data->nstrats; pos++) {
+		const idmgr_t *mgr = data->strat[pos].idmgr;
+		if (index < mgr->first || mgr->first + mgr->total <= index) continue;
+
+		const int pos_I = pos_of_pid(data->pid_I, mgr);
+		const int pos_J = pos_of_pid(data->pid_J, mgr);
+		const int pos_K = pos_of_pid(data->pid_K, mgr);
+
+		if (pos_I < 0 || pos_J < 0 || pos_K < 0) return false;
+
+		int buf[mgr->len];
+		mgr->decoder(index, buf, data->rank, p, mgr);
+
+		if (p->min[data->pid_K] == buf[pos_K]) return false;
+
+		*cell = buf[pos_I] * data->size + buf[pos_J];
+		return true;
+	}
+
+	assert(0);
+	return false;
+}
+
+static bool guard_holds (const char *mark, const bool *clue, int ncells)
+{
+	if (mark[0] == SKEL_ALWAYS && mark[1] == '\0') return true;
+
+	char *end;
+	const long cell = strtol(mark + 1, &end, 10);
+	if (end == mark + 1 || *end != '\0' || cell < 0 || ncells <= cell) {
+		fprintf(stderr, "ERROR: broken skeleton: bad guard\n");
+		exit(EXIT_FAILURE);
+	}
+
+	switch (mark[0]) {
+		case SKEL_CLUE:
+			return clue[cell];
+		case SKEL_NONCLUE:
+			return false == clue[cell];
+		default:
+			fprintf(stderr, "ERROR: broken skeleton: bad guard\n");
+			exit(EXIT_FAILURE);
+	}
+}
+
+// Copy a skeleton to out, keeping only the constraints
+// whose guards hold for the clues in data,
+// and the alternatives of names which hold for them (see fprint_name_of_x()).
+void splice_skeleton (sink_t *out, FILE *skel, const data_t *data)
+{
+	const int ncells = data->size * data->size;
+
+	bool clue[ncells];
+	for (int c = 0; c < ncells; c++) {
+		clue[c] = false;
+	}
+	for (int pos = 0; pos < data->nclues; pos++) {
+		clue[data->cs[pos].I * data->size + data->cs[pos].J] = true;
+	}
+
+	char *buf = (char*)malloc(SINK_BUFSIZE);
+	if (buf == NULL) {
+		fprintf(stderr, "ERROR: memory allocation failed\n");
+		exit(EXIT_FAILURE);
+	}
+
+	char mark[16];
+	int  mlen  = -1;   // length of the guard being read, or -1 outside of guards
+	bool shown = true; // whether the last guard holds
+	bool outer = true; // whether the last guard holds, within alternatives
+	bool alt   = true; // whether the condition of the current alternatives holds
+
+	size_t n;
+	while ((n = fread(buf, 1, SINK_BUFSIZE, skel)) > 0) {
+		const char *s   = buf;
+		const char *end = buf + n;
+
+		while (s < end) {
+			if (mlen >= 0) {
+				if (*s == SKEL_MARK_END) {
+					mark[mlen] = '\0';
+					switch (mark[0]) {
+						case SKEL_IF_CLUE:
+							mark[0] = SKEL_CLUE;
+							outer = shown;
+							alt   = guard_holds(mark, clue, ncells);
+							shown = outer && alt;
+							break;
+						case SKEL_ELSE:
+							shown = outer && false == alt;
+							break;
+						case SKEL_END_IF:
+							shown = outer;
+							break;
+						default:
+							shown = guard_holds(mark, clue, ncells);
+					}
+					mlen  = -1;
+				} else if (mlen + 1 < (int)sizeof(mark)) {
+					mark[mlen++] = *s;
+				} else {
+					fprintf(stderr, "ERROR: broken skeleton: bad guard\n");
+					exit(EXIT_FAILURE);
+				}
+				s++;
+				continue;
+			}
+
+			const char *t = memchr(s, SKEL_MARK, end - s);
+			const char *stop = (t != NULL) ? t: end;
+
+			if (shown) sink_write(out, s, stop - s);
+
+			if (t != NULL) {
+				mlen = 0;
+				s = t + 1;
+			} else {
+				s = end;
+			}
+		}
+	}
+
+	if (ferror(skel) || mlen >= 0) {
+		fprintf(stderr, "ERROR: cannot read skeleton\n");
+		exit(EXIT_FAILURE);
+	}
+
+	free(buf);
+}
+
+// Get the cell (i,j)
+cell_t cell_at (int i, int j, int r)
+{
+	cell_t q;
+	q.I = i;
+	q.J = j;
+
+	return q;	
+}
+
+// Get the m-th cell in the n-th block.
+cell_t cell_in_block (int m, int n, int r)
+{
+	cell_t q;
+	q.I = (n / r) * r + (m / r);
+	q.J = (n % r) * r + (m % r);
+
+	return q;
+}
+
+// Get (the index of ) the block to which the cell q belongs.
+int ownerblock (cell_t q, int r)
+{
+	return (q.I / r) * r + (q.J / r);
+}
+
+
+// Answer whether the cell q is in the n-th block.
+bool is_in_block (cell_t q, int n, int r)
+{
+	const int owener = ownerblock(q, r);
+
+	return owener == n;
+}
+
+// Answer whether the cell q is in the group of the type (r: row, c: column, b: block).
+bool is_in_group (cell_t q, int group, char type, int rank)
+{
+	switch (type) {
+		case 'r': return q.I == group;
+		case 'c': return q.J == group;
+		case 'b': return is_in_block(q, group, rank);
+		default:
+			assert(0);
+			exit(EXIT_FAILURE);
+	}
+}
+
+// For 1 <= n <= size,
 // x_i_j_k = n <---> n is placed at (i,j) in step k
 // x_i_j_k = 0 <---> no number is placed at (i,j) in step k
 //
-void fprint_decl_for_x (FILE *out, data_t *data) 
+// In the onehot encoding, x_i_j_k = n is the boolean variable p_i_j_n_k instead,
+// and x_i_j_k = 0 means that all of them are false.
+// At most one of them is true (see fprint_at_most_one()).
+//
+// X variables of clue cells are declared only in step 0 (see fprint_name_of_x()),
+// and in the time encoding, only X variables in step 0 are declared.
+//
+void fprint_decl_for_x (sink_t *out, data_t *data) 
 {
-	fprintf(out, ";\n");
-	fprintf(out, "; X Variables\n");
+	sink_puts(out, ";\n");
+	sink_puts(out, "; X Variables\n");
 
 	param_t *p = data->p;
 
@@ -631,6 +1492,28 @@ void fprint_decl_for_x (FILE *out, data_t *data)
 	const int pid_N = data->pid_N;
 	const int pid_K = data->pid_K;
 
+	if (data->encoding == ENCODING_ONEHOT) {
+		make_all_inactive(p);
+		make_IJNK_active(p);
+
+		for(reset_param(p); p->end == false; next_param(p)) {
+			const cell_t q = cell_at(p->cur[pid_I], p->cur[pid_J], data->rank);
+
+			for (int c = first_case(out, data, q); c != CASE_NONE; c = next_case(out, data, q, c)) {
+				if (c == CASE_CLUE && p->cur[pid_K] != p->min[pid_K]) continue;
+
+				sink_puts(out, "(bool ");
+				fprint_name_of_p(out,
+					p->cur[pid_I], 
+					p->cur[pid_J], 
+					p->cur[pid_N],
+					p->cur[pid_K]);
+				sink_endexpr(out, ")\n");
+			}
+		}
+		return;
+	}
+
 	make_all_inactive(p);
 	make_IJK_active(p);
 
@@ -638,20 +1521,33 @@ void fprint_decl_for_x (FILE *out, data_t *data)
 	assert(p->min[pid_N] == 1);
 
 	for(reset_param(p); p->end == false; next_param(p)) {
-		fprintf(out, "(int x_%d_%d_%d 0 %d)\n", 
-			p->cur[pid_I], 
-			p->cur[pid_J], 
-			p->cur[pid_K], 
-			maxnum);
+		if (data->encoding == ENCODING_TIME && p->cur[pid_K] != p->min[pid_K]) continue;
+
+		const cell_t q = cell_at(p->cur[pid_I], p->cur[pid_J], data->rank);
+
+		for (int c = first_case(out, data, q); c != CASE_NONE; c = next_case(out, data, q, c)) {
+			if (c == CASE_CLUE && p->cur[pid_K] != p->min[pid_K]) continue;
+
+			sink_puts(out, "(int ");
+			fprint_name_of_x(out,
+				p->cur[pid_I], 
+				p->cur[pid_J], 
+				p->cur[pid_K]);
+			sink_puts(out, " 0 ");
+			sink_putint(out, maxnum);
+			sink_endexpr(out, ")\n");
+		}
 	}
 }
 
 // y_i_j_n_k is true <---> n is a candidate at (i,j) in step k.
 //
-void fprint_decl_for_y (FILE *out, data_t *data) 
+// Y variables of clue cells are declared only in step 0 (see fprint_name_of_y()).
+//
+void fprint_decl_for_y (sink_t *out, data_t *data) 
 {
-	fprintf(out, ";\n");
-	fprintf(out, "; Y Variables\n");
+	sink_puts(out, ";\n");
+	sink_puts(out, "; Y Variables\n");
 
 	param_t *p = data->p;
 
@@ -664,20 +1560,29 @@ void fprint_decl_for_y (FILE *out, data_t *data)
 	make_IJNK_active(p);
 
 	for(reset_param(p); p->end == false; next_param(p)) {
-		fprintf(out, "(bool y_%d_%d_%d_%d)\n", 
-			p->cur[pid_I], 
-			p->cur[pid_J], 
-			p->cur[pid_N],
-			p->cur[pid_K]);
+		const cell_t q = cell_at(p->cur[pid_I], p->cur[pid_J], data->rank);
+
+		for (int c = first_case(out, data, q); c != CASE_NONE; c = next_case(out, data, q, c)) {
+			if (c == CASE_CLUE && p->cur[pid_K] != p->min[pid_K]) continue;
+
+			sink_puts(out, "(bool ");
+			fprint_name_of_y(out,
+				p->cur[pid_I], 
+				p->cur[pid_J], 
+				p->cur[pid_N],
+				p->cur[pid_K]);
+			sink_endexpr(out, ")\n");
+		}
 	}
 }
 
+
 // z_m is true <---> some strategy or sudoku rule is applicable.
 //
-void fprint_decl_for_z (FILE *out, data_t *data) 
+void fprint_decl_for_z (sink_t *out, data_t *data) 
 {
-	fprintf(out, ";\n");
-	fprintf(out, "; Z Variables\n");
+	sink_puts(out, ";\n");
+	sink_puts(out, "; Z Variables\n");
 
 	const param_t *p = data->p;
 
@@ -695,9 +1600,24 @@ void fprint_decl_for_z (FILE *out, data_t *data)
 		for (int index = first; index < end; index++) {
 			mgr->decoder(index, buf, rank, p, mgr);
 
-			if (true == mgr->accepted(buf, data)) {
-				fprintf(out, "(bool z_%d)\n", index);
+			if (false == mgr->accepted(buf, data)) {
+				// Only the indices reserved for skeletons may be left undeclared,
+				// so that the largest index stays close to the number of Z variables (see renumber_ids()).
+				assert(true == accepted_in_skeleton(mgr, buf, data));
+				continue;
 			}
+
+			if (out->inliner != NULL && out->inliner->length[index] > 0) continue;
+
+			int cell;
+			const bool guarded = guard_of_z(data, index, &cell);
+			if (guarded) fprint_guard(out, SKEL_NONCLUE, cell);
+
+			sink_puts(out, "(bool ");
+			fprint_name_of_z(out, index);
+			sink_endexpr(out, ")\n");
+
+			if (guarded) fprint_guard(out, SKEL_ALWAYS, -1);
 		}
 
 		free(buf);
@@ -710,10 +1630,10 @@ void fprint_decl_for_z (FILE *out, data_t *data)
 // For any non-clue cell (i,j),
 // x_i_j_0 = 0  <---> no number is placed at (i,j) in step 0.
 //
-void fprint_cons_for_init (FILE *out, data_t *data) 
+void fprint_cons_for_init (sink_t *out, data_t *data) 
 {
-	fprintf(out, ";\n");
-	fprintf(out, "; Constraints for Initial States\n");
+	sink_puts(out, ";\n");
+	sink_puts(out, "; Constraints for Initial States\n");
 
 	param_t *p = data->p;
 
@@ -731,10 +1651,26 @@ void fprint_cons_for_init (FILE *out, data_t *data)
 				p->cur[pid_J],
 				rank);
 
-		if (is_clue_cell(q, data->cs, data->nclues)) {
-			fprintf(out, "(!= x_%d_%d_0 0)\n", q.I, q.J);	
-		} else {
-			fprintf(out, "(=  x_%d_%d_0 0)\n", q.I, q.J);	
+		for (int c = first_case(out, data, q); c != CASE_NONE; c = next_case(out, data, q, c)) {
+			if (data->encoding == ENCODING_ONEHOT) {
+				if (c == CASE_CLUE) {
+					fprint_placed(out, data, q.I, q.J, 0);
+					sink_endexpr(out, "\n");
+					fprint_at_most_one(out, data, q.I, q.J, 0);
+				} else {
+					sink_puts(out, "(not");
+					fprint_placed(out, data, q.I, q.J, 0);
+					sink_endexpr(out, ")\n");
+				}
+			} else if (c == CASE_CLUE) {
+				sink_puts(out, "(!= ");
+				fprint_name_of_x(out, q.I, q.J, 0);
+				sink_endexpr(out, " 0)\n");
+			} else {
+				sink_puts(out, "(=  ");
+				fprint_name_of_x(out, q.I, q.J, 0);
+				sink_endexpr(out, " 0)\n");
+			}
 		}
 	}
 
@@ -762,20 +1698,20 @@ void fprint_cons_for_init (FILE *out, data_t *data)
 //		   	    or sudoku rule is applicable in step k
 //			    or y_i_j_n_{k-1} is false.
 //
-void fprint_cons_for_trans (FILE *out, data_t *data) 
+// Clue cells do not change, and their variables after step 0 are substituted by those in step 0
+// (see fprint_name_of_x()), so that no constraint is needed for them.
+//
+void fprint_cons_for_trans (sink_t *out, data_t *data) 
 {
-	fprintf(out, ";\n");
-	fprintf(out, "; Constraints for State Transitions\n");
+	sink_puts(out, ";\n");
+	sink_puts(out, "; Constraints for State Transitions\n");
 
 	param_t *p = data->p;
 
 	const int pid_I = data->pid_I;
 	const int pid_J = data->pid_J;
-	const int pid_N = data->pid_N;
 	const int pid_K = data->pid_K;
 
-	const int nstrats = data->nstrats; 
-
 	make_all_inactive(p);
 	make_IJNK_active(p);
 
@@ -789,52 +1725,33 @@ void fprint_cons_for_trans (FILE *out, data_t *data)
 					p->cur[pid_J],
 					data->rank);
 
-		if (is_clue_cell(q, data->cs, data->nclues)) {
-			fprintf(out, "(iff ");
-		  	  fprint_literal(out, 'x', 
-				p->cur[pid_I], 
-				p->cur[pid_J], 
-				p->cur[pid_N],
-				p->cur[pid_K]);
-
-		  	  fprint_literal(out, 'x', 
-				p->cur[pid_I], 
-				p->cur[pid_J], 
-				p->cur[pid_N],
-				p->cur[pid_K]-1);
-
-			fprintf(out, ")\n");
-
-			continue;
+		for (int c = first_case(out, data, q); c != CASE_NONE; c = next_case(out, data, q, c)) {
+			if (c == CASE_NONCLUE) {
+				fprint_trans_by_strats(out, data, 'x');
+			}
 		}
+	}
 
+	// In the onehot encoding, placement variables of clue cells are those of step 0,
+	// so that at most one of them is true without further constraints.
+	if (data->encoding == ENCODING_ONEHOT) {
+		make_all_inactive(p);
+		make_IJK_active(p);
 
-		fprintf(out, "(iff ");
-
-		    fprint_literal(out, 'x', 
-			p->cur[pid_I], 
-			p->cur[pid_J], 
-			p->cur[pid_N],
-			p->cur[pid_K]);
+		for(reset_param(p); p->end == false; next_param(p)) {
+			if (p->min[pid_K] == p->cur[pid_K]) continue; 
 
-		fprintf(out, " (or ");
+			const cell_t q = cell_at(
+						p->cur[pid_I],
+						p->cur[pid_J],
+						data->rank);
 
-		    for (int pos = 0; pos < nstrats; pos++) {
-		    	if (data->strat[pos].fprint_literals_for_x != NULL) {
-				data->strat[pos].fprint_literals_for_x(out, data);
+			for (int c = first_case(out, data, q); c != CASE_NONE; c = next_case(out, data, q, c)) {
+				if (c == CASE_NONCLUE) {
+					fprint_at_most_one(out, data, q.I, q.J, p->cur[pid_K]);
+				}
 			}
-		    }
-
-		    if (p->cur[pid_K] > p->min[pid_K]) {
-		    	fprint_literal(out, 'x', 
-				p->cur[pid_I], 
-				p->cur[pid_J], 
-				p->cur[pid_N],
-				p->cur[pid_K] - 1);
-		    }
-
-		fprintf(out, ")");
-		fprintf(out, ")\n");
+		}
 	}
 
 	make_all_inactive(p);
@@ -847,64 +1764,130 @@ void fprint_cons_for_trans (FILE *out, data_t *data)
 					p->cur[pid_J],
 					data->rank);
 
-		if (p->min[pid_K] < p->cur[pid_K] 
-		&&  is_clue_cell(q, data->cs, data->nclues)) {
+		// the sudoku rule is applicable to clue cells in step 0
+		if (p->min[pid_K] == p->cur[pid_K]) {
+			fprint_trans_by_strats(out, data, 'y');
+			continue;
+		}
 
-			fprintf(out, "(iff ");
-			  fprint_literal(out, 'y', 
-				p->cur[pid_I], 
-				p->cur[pid_J], 
-				p->cur[pid_N],
-				p->cur[pid_K]);
+		for (int c = first_case(out, data, q); c != CASE_NONE; c = next_case(out, data, q, c)) {
+			if (c == CASE_NONCLUE) {
+				fprint_trans_by_strats(out, data, 'y');
+			}
+		}
+	}
 
-			  fprint_literal(out, 'y', 
-				p->cur[pid_I], 
-				p->cur[pid_J], 
-				p->cur[pid_N],
-				p->cur[pid_K] - 1);
-			fprintf(out, ")\n");
+}
 
-			continue;
+// Some number is placed at (i,j) in step k:
+// (!= x_i_j_k 0), or the disjunction of p_i_j_n_k for all n in the onehot encoding.
+void fprint_placed (sink_t *out, const data_t *data, int i, int j, int k)
+{
+	if (data->encoding == ENCODING_ONEHOT) {
+		sink_puts(out, " (or");
+		for (int n = 1; n <= data->size; n++) {
+			sink_putc(out, ' ');
+			fprint_name_of_p(out, i, j, n, k);
 		}
+		sink_puts(out, ") ");
+		return;
+	}
+
+	sink_puts(out, " (!= ");
+	fprint_name_of_x(out, i, j, k);
+	sink_puts(out, " 0) ");
+}
 
-		fprintf(out, "(iff ");
+// In the onehot encoding, at most one number is placed at (i,j) in step k:
+// (or (not p_i_j_n_k) (not p_i_j_m_k)) for all 1 <= n < m <= size.
+static void fprint_at_most_one (sink_t *out, const data_t *data, int i, int j, int k)
+{
+	for (int n = 1; n <= data->size; n++) {
+		for (int m = n + 1; m <= data->size; m++) {
+			sink_puts(out, "(or (not ");
+			fprint_name_of_p(out, i, j, n, k);
+			sink_puts(out, ") (not ");
+			fprint_name_of_p(out, i, j, m, k);
+			sink_endexpr(out, "))\n");
+		}
+	}
+}
 
-		  fprint_literal(out, 'y', 
+// For the current values of I, J, N, and K,
+// the literal of symb in step k is equivalent to the disjunction of
+// the literals of all strategies and that in step k-1.
+//
+// Before the step from which a number can be placed at (i,j) or its candidate eliminated (see init_reach()),
+// the literal is false instead, and no literal of strategies is accepted.
+static void fprint_trans_by_strats (sink_t *out, const data_t *data, char symb)
+{
+	const param_t *p = data->p;
+
+	const int pid_I = data->pid_I;
+	const int pid_J = data->pid_J;
+	const int pid_N = data->pid_N;
+	const int pid_K = data->pid_K;
+
+	const int nstrats = data->nstrats; 
+
+	const cell_t q = cell_at(p->cur[pid_I], p->cur[pid_J], data->rank);
+	const int first = (symb == 'x') ? first_placement(data, q): first_elimination(data, q);
+
+	if (p->cur[pid_K] < first) {
+		sink_puts(out, "(not");
+		fprint_literal(out, symb, 
 			p->cur[pid_I], 
 			p->cur[pid_J], 
 			p->cur[pid_N],
 			p->cur[pid_K]);
+		sink_endexpr(out, ")\n");
+		return;
+	}
 
-		  fprintf(out, " (or ");
+	sink_puts(out, "(iff ");
 
-		    for (int pos = 0; pos < nstrats; pos++) {
-		    	if (data->strat[pos].fprint_literals_for_y != NULL) {
-				data->strat[pos].fprint_literals_for_y(out, data);
-			}
-						
-		    }
+	  fprint_literal(out, symb, 
+		p->cur[pid_I], 
+		p->cur[pid_J], 
+		p->cur[pid_N],
+		p->cur[pid_K]);
 
-		    if (p->cur[pid_K] > p->min[pid_K]) {
-			fprint_literal (out, 'y', 
-				p->cur[pid_I], 
-				p->cur[pid_J], 
-				p->cur[pid_N],
-				p->cur[pid_K]-1);
-		    }
+	  sink_puts(out, " (or ");
 
-		  fprintf(out, ")");
-		fprintf(out, ")\n");
-	}
+	    for (int pos = 0; pos < nstrats; pos++) {
+		void (*fprint_literals) (sink_t *, const data_t *) = (symb == 'x')
+				? data->strat[pos].fprint_literals_for_x
+				: data->strat[pos].fprint_literals_for_y;
+	    	if (fprint_literals != NULL) {
+			fprint_literals(out, data);
+		}
+	    }
+
+	    if (p->cur[pid_K] > p->min[pid_K]) {
+	    	fprint_literal(out, symb, 
+			p->cur[pid_I], 
+			p->cur[pid_J], 
+			p->cur[pid_N],
+			p->cur[pid_K] - 1);
+	    }
 
+	  sink_puts(out, ")");
+	sink_endexpr(out, ")\n");
 }
 
 // The condition on the left means that the grid does not change between k-1 and k.
 // The condition on the right means that all cells are completed in step k.
+// With flags of final states, both are auxiliary variables (see scg_final.h).
 //
-void fprint_cons_for_final (FILE *out, data_t *data) 
+void fprint_cons_for_final (sink_t *out, data_t *data) 
 {
-	fprintf(out, ";\n");
-	fprintf(out, "; Constraints for Final States\n");
+	sink_puts(out, ";\n");
+	sink_puts(out, "; Constraints for Final States\n");
+
+	if (get_idmgr(tag_FS, data) != NULL) {
+		fprint_final_by_flags(out, data);
+		return;
+	}
 
 	param_t *p = data->p;
 
@@ -913,51 +1896,61 @@ void fprint_cons_for_final (FILE *out, data_t *data)
 	const int pid_N = data->pid_N;
 	const int pid_K = data->pid_K;
 
-	for (int k = p->min[pid_K] + 1; k <= p->max[pid_K]; k++) {
+	// In sequential mode, the grid is compared with that of the previous round,
+	// because a single strategy may not change it although the others do.
+	const int round = data->round;
+
+	for (int k = p->min[pid_K] + round; k <= p->max[pid_K]; k += round) {
 		// Note: the initial step must be skipped
 
 		make_all_inactive(p);
 		make_IJN_active(p);
 
-		fprintf(out, "(imp ");
+		sink_puts(out, "(imp ");
 
-		fprintf(out, "(and ");
+		sink_puts(out, "(and ");
 		for(reset_param(p); p->end == false; next_param(p)) {
 			cell_t q = cell_at(
 					p->cur[pid_I],
 					p->cur[pid_J],
 					data->rank);
-			if (false == is_clue_cell(q, data->cs, data->nclues)) {
-				fprintf(out, " (iff y_%d_%d_%d_%d y_%d_%d_%d_%d) ", 
-					q.I, q.J, p->cur[pid_N], k - 1, 
-					q.I, q.J, p->cur[pid_N], k);   
+			for (int c = first_case(out, data, q); c != CASE_NONE; c = next_case(out, data, q, c)) {
+				if (c == CASE_NONCLUE) {
+					sink_puts(out, " (iff ");
+					fprint_name_of_y(out, q.I, q.J, p->cur[pid_N], k - round);
+					sink_putc(out, ' ');
+					fprint_name_of_y(out, q.I, q.J, p->cur[pid_N], k);
+					sink_puts(out, ") ");
+				}
 			}
 		}
-		fprintf(out, ") ");
+		sink_puts(out, ") ");
 
 		make_all_inactive(p);
 		make_IJ_active(p);
 
-		fprintf(out, "(and ");
+		sink_puts(out, "(and ");
 		for(reset_param(p); p->end == false; next_param(p)) {
 			cell_t q = cell_at(
 					p->cur[pid_I],
 					p->cur[pid_J],
 					data->rank);
 
-			if (false == is_clue_cell(q, data->cs, data->nclues)) {
-				fprintf(out, " (!= x_%d_%d_%d 0) ", q.I, q.J, k);
+			for (int c = first_case(out, data, q); c != CASE_NONE; c = next_case(out, data, q, c)) {
+				if (c == CASE_NONCLUE) {
+					fprint_placed(out, data, q.I, q.J, k);
+				}
 			}
 		}
-		fprintf(out, ")");
+		sink_puts(out, ")");
 
-		fprintf(out, ")\n");
+		sink_endexpr(out, ")\n");
 
 	}
 
 }
 
-void fprint_cons_for_strat (FILE *out, data_t *data)
+void fprint_cons_for_strat (sink_t *out, data_t *data)
 {
 	const int len = data->nstrats;
 
@@ -970,6 +1963,115 @@ void fprint_cons_for_strat (FILE *out, data_t *data)
 	}
 }
 
+// Implied constraints, which hold in every model and are printed only to help solvers:
+//
+// placements persist:   (= x_i_j_k n)     ---> (= x_i_j_k+1 n),
+// eliminations persist: (not y_i_j_n_k)   ---> (not y_i_j_n_k+1),
+// clues are different:  (= x_a_0 n) and (= x_b_0 n) do not hold both for clue cells a and b in a row, column, or block.
+//
+// Hence a grid complete in step k is complete in all later steps as well.
+// Those of clue cells after step 0 are omitted, whose variables are those of step 0 (see fprint_name_of_x()),
+// and so are those from the steps before the bounds of init_reach(), in which the variables are fixed.
+// With flags of final states, stable and complete steps persist as well (see fprint_hints_for_final_flags()).
+void fprint_cons_for_hints (sink_t *out, data_t *data)
+{
+	if (false == data->use_hints) return;
+	assert(false == data->skeleton);
+
+	sink_puts(out, ";\n");
+	sink_puts(out, "; Implied Constraints\n");
+
+	const int size  = data->size;
+	const int rank  = data->rank;
+	const int bound = data->bound;
+
+	for (int c = 0; c < size * size; c++) {
+		if (data->clue[c]) continue;
+
+		const cell_t q = cell_at(c / size, c % size, rank);
+
+		// no number is placed at a non-clue cell in step 0.
+		const int from = (first_placement(data, q) > 1 ? first_placement(data, q): 1);
+
+		for (int k = from; k < bound; k++) {
+			for (int n = 1; n <= size; n++) {
+				sink_puts(out, "(imp ");
+				fprint_literal(out, 'x', q.I, q.J, n, k);
+				fprint_literal(out, 'x', q.I, q.J, n, k + 1);
+				sink_endexpr(out, ")\n");
+			}
+		}
+
+		for (int k = first_elimination(data, q); k < bound; k++) {
+			for (int n = 1; n <= size; n++) {
+				sink_puts(out, "(imp ");
+				fprint_literal(out, 'y', q.I, q.J, n, k);
+				fprint_literal(out, 'y', q.I, q.J, n, k + 1);
+				sink_endexpr(out, ")\n");
+			}
+		}
+	}
+
+	for (int a = 0; a < data->nclues; a++) {
+		for (int b = a + 1; b < data->nclues; b++) {
+			const cell_t qa = data->cs[a];
+			const cell_t qb = data->cs[b];
+
+			if (qa.I != qb.I && qa.J != qb.J && ownerblock(qa, rank) != ownerblock(qb, rank)) continue;
+
+			for (int n = 1; n <= size; n++) {
+				sink_puts(out, "(or (not ");
+				fprint_literal(out, 'x', qa.I, qa.J, n, 0);
+				sink_puts(out, ") (not ");
+				fprint_literal(out, 'x', qb.I, qb.J, n, 0);
+				sink_endexpr(out, "))\n");
+			}
+		}
+	}
+
+	if (get_idmgr(tag_FS, data) != NULL) fprint_hints_for_final_flags(out, data);
+}
+
+// Symmetry breaking of numbers: all constraints are the same under any permutation of 1, ..., size,
+// which relabels the numbers of clues of a model into those of another model.
+// Among them, only the labelling is allowed in which the numbers first occur in increasing order
+// in the order of clue cells cs[0], cs[1], ..., i.e., n > 1 is placed at a clue cell only after n-1:
+//
+// (= x_t_0 n) ---> (or (= x_s_0 n-1) ...) over all clue cells s before t,
+//
+// so that cs[0] has 1. Every model has such a relabelling, and the satisfiability is unchanged.
+void fprint_cons_for_symmetry (sink_t *out, data_t *data)
+{
+	if (false == data->use_symmetry) return;
+	assert(false == data->skeleton);
+
+	sink_puts(out, ";\n");
+	sink_puts(out, "; Symmetry Breaking of Numbers\n");
+
+	const int size = data->size;
+	const cell_t *cs = data->cs;
+
+	for (int t = 0; t < data->nclues; t++) {
+		for (int n = 2; n <= size; n++) {
+			// n-1 cannot occur before cs[t], and neither can n.
+			if (n - 1 > t) {
+				sink_puts(out, "(not ");
+				fprint_literal(out, 'x', cs[t].I, cs[t].J, n, 0);
+				sink_endexpr(out, ")\n");
+				continue;
+			}
+
+			sink_puts(out, "(imp ");
+			fprint_literal(out, 'x', cs[t].I, cs[t].J, n, 0);
+			sink_puts(out, "(or ");
+			for (int s = 0; s < t; s++) {
+				fprint_literal(out, 'x', cs[s].I, cs[s].J, n - 1, 0);
+			}
+			sink_endexpr(out, "))\n");
+		}
+	}
+}
+
 // Let group_A be a row index, and let group_B be a block index.
 // This function determines whether A and B have common cells.
 static bool have_common_cell_ARBB (int group_A, int group_B, int rank)
@@ -1025,7 +2127,8 @@ bool have_common_cell(int group_A, int group_B, int type_AB, int rank)
 	return false;
 }
 
-// Print out all literals while parameters running over all possible cases.
+// Collect all literals while parameters running over all possible cases,
+// and return the number of them, where lits must have length at least size.
 // The function arg->test() determines whether the current case is accepted or not.
 // [example]
 // test_not_equal_number() determines whether the current number is not equal to a particular number.
@@ -1035,7 +2138,7 @@ bool have_common_cell(int group_A, int group_B, int type_AB, int rank)
 // * The particular number, cell, and block must be set by set_testarg() in advance.
 // * In accordance with this, the corresponding test function must be set by set_runarg() in advance.
 //
-void fprint_literals_running_over (FILE *out, const param_t *p, const runarg_t *arg)
+int collect_literals (const param_t *p, const runarg_t *arg, lit_t *lits)
 {
 	const int rank = arg->testarg->rank;
 
@@ -1050,6 +2153,7 @@ void fprint_literals_running_over (FILE *out, const param_t *p, const runarg_t *
 	assert(pid_K >= 0);
 
 	cur_t cur;
+	int len = 0;
 
 	switch (arg->type) {
 		case 'v':
@@ -1065,12 +2169,7 @@ void fprint_literals_running_over (FILE *out, const param_t *p, const runarg_t *
 				cur.J = arg->fixed_J;
 
 				if (arg->test(&cur, arg->testarg) == true) {
-					fprint_literal(out,
-						arg->symb,
-						arg->fixed_I, 
-						arg->fixed_J, 
-						cur.N,
-						arg->fixed_K);
+					set_lit(&lits[len++], arg->symb, arg->fixed_I, arg->fixed_J, cur.N, arg->fixed_K);
 				}
 
 			}
@@ -1090,12 +2189,7 @@ void fprint_literals_running_over (FILE *out, const param_t *p, const runarg_t *
 				cur.N = arg->fixed_N;
 
 				if (arg->test(&cur, arg->testarg) == true) {
-					fprint_literal(out,
-						arg->symb,
-						arg->fixed_I, 
-						cur.J, 
-						arg->fixed_N,
-						arg->fixed_K);
+					set_lit(&lits[len++], arg->symb, arg->fixed_I, cur.J, arg->fixed_N, arg->fixed_K);
 
 				}
 
@@ -1117,12 +2211,7 @@ void fprint_literals_running_over (FILE *out, const param_t *p, const runarg_t *
 
 				if (arg->test(&cur, arg->testarg) == true) {
 
-					fprint_literal(out,
-						arg->symb,
-						cur.I, 
-						arg->fixed_J, 
-						arg->fixed_N,
-						arg->fixed_K);
+					set_lit(&lits[len++], arg->symb, cur.I, arg->fixed_J, arg->fixed_N, arg->fixed_K);
 
 				}
 			}
@@ -1148,12 +2237,7 @@ void fprint_literals_running_over (FILE *out, const param_t *p, const runarg_t *
 
 				if (arg->test(&cur, arg->testarg) == true) {
 
-					fprint_literal(out,
-						arg->symb,
-						cur.I, 
-						cur.J, 
-						arg->fixed_N,
-						arg->fixed_K);
+					set_lit(&lits[len++], arg->symb, cur.I, cur.J, arg->fixed_N, arg->fixed_K);
 				}
 			}
 
@@ -1164,24 +2248,373 @@ void fprint_literals_running_over (FILE *out, const param_t *p, const runarg_t *
 			exit(EXIT_FAILURE);
 	}
 
+	return len;
+}
+
+static void set_lit (lit_t *lit, char symb, int i, int j, int n, int k)
+{
+	lit->symb = symb;
+	lit->I    = i;
+	lit->J    = j;
+	lit->N    = n;
+	lit->K    = k;
+}
+
+// Print out all literals while parameters running over all possible cases (see collect_literals()).
+void fprint_literals_running_over (sink_t *out, const param_t *p, const runarg_t *arg)
+{
+	const int size = arg->testarg->rank * arg->testarg->rank;
+	lit_t lits[size];
+
+	const int len = collect_literals(p, arg, lits);
+
+	for (int pos = 0; pos < len; pos++) {
+		fprint_literal(out, lits[pos].symb, lits[pos].I, lits[pos].J, lits[pos].N, lits[pos].K);
+	}
 }
 
-void fprint_term (FILE *out, const param_t *p, const runarg_t *arg)
+void fprint_term (sink_t *out, const param_t *p, const runarg_t *arg)
 {
-	fprintf(out, "(and ");
+	sink_puts(out, "(and ");
 
 	fprint_literals_running_over(out, p, arg);
 
-	fprintf(out, " )\n");
+	sink_puts(out, " )\n");
 }
 
-void fprint_clause (FILE *out, const param_t *p, const runarg_t *arg)
+void fprint_clause (sink_t *out, const param_t *p, const runarg_t *arg)
 {
-	fprintf(out, "(or ");
+	sink_puts(out, "(or ");
 
 	fprint_literals_running_over(out, p, arg);
 
-	fprintf(out, " )\n");
+	sink_puts(out, " )\n");
+}
+
+// Print out the definition of z_index by the conjunction of literals:
+// (iff z_index (and ...)),
+// or a call of the predicate for the same shape if predicates are enabled,
+// or by aggregates if the literals are those of all cells of a unit but one (see fprint_all_but_one()).
+void fprint_definition_by_term (sink_t *out, const data_t *data, int index, const runarg_t *arg)
+{
+	fprint_definition(out, data, index, "and", arg, 1);
+}
+
+// Print out the definition of z_index by the disjunction of literals:
+// (iff z_index (or ...)),
+// or a call of the predicate for the same shape if predicates are enabled,
+// or by aggregates if the literals are those of all cells of a unit but one (see fprint_all_but_one()).
+void fprint_definition_by_clause (sink_t *out, const data_t *data, int index, const runarg_t *arg)
+{
+	fprint_definition(out, data, index, "or", arg, 1);
+}
+
+// Print out the definition of z_index by the disjunction of the conjunctions of the literals of nargs runs:
+// (iff z_index (or (and ...) ... (and ...))), for fused variables (see data_t).
+void fprint_definition_by_terms (sink_t *out, const data_t *data, int index, const runarg_t *args, int nargs)
+{
+	fprint_definition(out, data, index, "and", args, nargs);
+}
+
+// Print out the definition of z_index by the disjunction of the literals of nargs runs,
+// which is flattened into a single clause: (iff z_index (or ...)), for fused variables (see data_t).
+void fprint_definition_by_clauses (sink_t *out, const data_t *data, int index, const runarg_t *args, int nargs)
+{
+	fprint_definition(out, data, index, "or", args, nargs);
+}
+
+static void fprint_definition (sink_t *out, const data_t *data, int index, const char *connective, const runarg_t *args, int nargs)
+{
+	assert(nargs == 1 || false == data->use_predicates);
+
+	if (skip_definition(out, data, index, connective, args, nargs)) return;
+
+	int cell;
+	const bool guarded = guard_of_z(data, index, &cell);
+	if (guarded) fprint_guard(out, SKEL_NONCLUE, cell);
+
+	if (data->use_predicates) {
+		fprint_call_of_predicate(out, data, index, connective, args);
+	} else {
+		// Locked Candidates have always printed one space less before z_index.
+		sink_puts(out, tag_of_z(data, index) == tag_LC ? "(iff": "(iff ");
+		fprint_z_literal(out, index);
+		fprint_body(out, data, connective, args, nargs);
+		sink_endexpr(out, " )\n");
+	}
+
+	if (guarded) fprint_guard(out, SKEL_ALWAYS, -1);
+}
+
+// Print out the body of a definition, i.e., the conjunction or disjunction of literals,
+// or the formula by aggregates if the literals are those of all cells of a unit but one.
+// The bodies of several runs are joined by a disjunction.
+static void fprint_body (sink_t *out, const data_t *data, const char *connective, const runarg_t *args, int nargs)
+{
+	const bool term = (strcmp(connective, "and") == 0);
+
+	if (nargs == 1) {
+		if (is_all_but_one(data, args, connective)) fprint_all_but_one(out, data, args);
+		else if (term)                              fprint_term(out, data->p, args);
+		else                                        fprint_clause(out, data->p, args);
+		return;
+	}
+
+	lit_t lits[nargs * data->size];
+	int len = 0;
+
+	sink_puts(out, "(or ");
+	for (int a = 0; a < nargs; a++) {
+		if (term)                                            fprint_body(out, data, connective, args + a, 1);
+		else if (is_all_but_one(data, args + a, connective)) fprint_operands_of_all_but_one(out, data, args + a);
+		else                                                 len = union_of_literals(data, args + a, lits, len);
+	}
+	for (int pos = 0; pos < len; pos++) {
+		fprint_literal(out, lits[pos].symb, lits[pos].I, lits[pos].J, lits[pos].N, lits[pos].K);
+	}
+	sink_puts(out, " )\n");
+}
+
+// Append the literals of arg to lits[0], ..., lits[len-1], except those already in them,
+// e.g., those of cells in both the row and the block, and return the new length.
+static int union_of_literals (const data_t *data, const runarg_t *arg, lit_t *lits, int len)
+{
+	lit_t run[data->size];
+	const int n = collect_literals(data->p, arg, run);
+
+	for (int t = 0; t < n; t++) {
+		bool found = false;
+		for (int pos = 0; pos < len && false == found; pos++) {
+			found = lits[pos].symb == run[t].symb && lits[pos].I == run[t].I && lits[pos].J == run[t].J
+			     && lits[pos].N == run[t].N && lits[pos].K == run[t].K;
+		}
+		if (false == found) lits[len++] = run[t];
+	}
+
+	return len;
+}
+
+// Whether the definition of z_index is not printed as usual because of inlining:
+// while bodies are collected, the body is kept if it is short enough, and nothing else is printed;
+// afterwards, the definitions of inlined variables are skipped.
+static bool skip_definition (sink_t *out, const data_t *data, int index, const char *connective, const runarg_t *args, int nargs)
+{
+	inliner_t *in = out->inliner;
+	if (in == NULL) return false;
+
+	if (false == in->collecting) return in->length[index] > 0;
+
+	assert(out == &(in->bodies));
+	out->len = in->end; // discard the others printed since the last body, e.g., comments
+
+	lit_t lits[nargs * data->size];
+	int len   = 0; // literals joined into a single clause
+	int count = 0;
+	for (int a = 0; a < nargs; a++) {
+		if (is_all_but_one(data, args + a, connective)) {
+			count += 2;
+		} else if (nargs > 1 && strcmp(connective, "or") == 0) {
+			len = union_of_literals(data, args + a, lits, len);
+		} else {
+			lit_t run[data->size];
+			count += collect_literals(data->p, args + a, run);
+		}
+	}
+	count += len;
+
+	if (count <= in->limit && is_inlinable(data, index)) {
+		fprint_body(out, data, connective, args, nargs);
+
+		assert(out->len > in->end && out->buf[out->len - 1] == '\n');
+		out->len--;
+
+		in->offset[index] = in->end;
+		in->length[index] = out->len - in->end;
+		in->end           = out->len;
+	}
+
+	return true;
+}
+
+// Whether z_index can be inlined: it must appear only once in constraints,
+// which is the case for variables of a cell, and not for those of groups, e.g., of Locked Candidates.
+static bool is_inlinable (const data_t *data, int index)
+{
+	for (int s = 0; s < data->nstrats; s++) {
+		const idmgr_t *mgr = data->strat[s].idmgr;
+		if (index < mgr->first || index >= mgr->first + mgr->total) continue;
+
+		return pos_of_pid(data->pid_I, mgr) >= 0 && pos_of_pid(data->pid_J, mgr) >= 0;
+	}
+
+	return false;
+}
+
+// Tag of the strategy which z_index belongs to.
+static stag_t tag_of_z (const data_t *data, int index)
+{
+	for (int s = 0; s < data->nstrats; s++) {
+		const idmgr_t *mgr = data->strat[s].idmgr;
+		if (index < mgr->first || index >= mgr->first + mgr->total) continue;
+
+		return data->strat[s].tag;
+	}
+
+	assert(0);
+	exit(EXIT_FAILURE);
+}
+
+// Definitions of at most limit literals are inlined into the constraints of out,
+// where the bodies are collected in advance by printing all definitions into a memory sink,
+// which needs the same tokens and names as out.
+void init_inliner (inliner_t *in, sink_t *out, data_t *data, int limit)
+{
+	assert(out->inliner == NULL);
+	assert(false == data->use_predicates);
+
+	in->limit  = limit;
+	in->end    = 0;
+	in->offset = (size_t*)calloc(data->nissued, sizeof(size_t));
+	in->length = (size_t*)calloc(data->nissued, sizeof(size_t));
+	if (in->offset == NULL || in->length == NULL) {
+		fprintf(stderr, "ERROR: Memory allocation failed.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	sink_t *bodies = &(in->bodies);
+	init_sink(bodies, NULL, false, false);
+	bodies->tokens  = out->tokens;
+	bodies->names   = out->names;
+	bodies->onehot  = out->onehot;
+	bodies->clues   = out->clues;
+	bodies->inliner = in;
+
+	in->collecting = true;
+	for (int s = 0; s < data->nstrats; s++) {
+		data->strat[s].fprint_cons_for_z(bodies, data);
+		bodies->len = in->end;
+	}
+	in->collecting = false;
+
+	out->inliner = in;
+}
+
+void delete_inliner (inliner_t *in)
+{
+	delete_sink(&(in->bodies));
+
+	free(in->offset);
+	free(in->length);
+}
+
+// Predicates for the shapes of definitions of Z variables, where m is the number of literals:
+//
+// (and_not<m> z a1 ... am)  : z <---> (and (not a1) ... (not am))  for Y variables a1, ..., am.
+// (or_eq<m>   z n a1 ... am): z <---> (or (= a1 n) ... (= am n))  for X variables a1, ..., am.
+// (or_ne      z a n)        : z <---> a is some number other than n, i.e. (and (!= a 0) (!= a n)).
+//
+// and_not<size-1> is used by Naked and Hidden Singles, and_not<size-rank> by Locked Candidates,
+// or_eq<size-1> and or_ne by the Sudoku rule.
+//
+// In the onehot encoding, X literals are boolean, and the Sudoku rule uses
+// (or_p<m> z a1 ... am) : z <---> (or a1 ... am)  for placement variables a1, ..., am.
+void fprint_decl_for_predicates (sink_t *out, const data_t *data)
+{
+	if (false == data->use_predicates) return;
+
+	sink_puts(out, ";\n");
+	sink_puts(out, "; Predicates\n");
+
+	const int size = data->size;
+	const int rank = data->rank;
+
+	const int arity[2] = {size - 1, size - rank};
+	for (int pos = 0; pos < 2; pos++) {
+		const int m = arity[pos];
+		if (pos > 0 && m == arity[0]) continue;
+
+		sink_printf(out, "(predicate (and_not%d z", m);
+		for (int t = 1; t <= m; t++) sink_printf(out, " a%d", t);
+		sink_puts(out, ") (iff z (and");
+		for (int t = 1; t <= m; t++) sink_printf(out, " (not a%d)", t);
+		sink_endexpr(out, ")))\n");
+	}
+
+	if (data->encoding == ENCODING_ONEHOT) {
+		sink_printf(out, "(predicate (or_p%d z", size - 1);
+		for (int t = 1; t < size; t++) sink_printf(out, " a%d", t);
+		sink_puts(out, ") (iff z (or");
+		for (int t = 1; t < size; t++) sink_printf(out, " a%d", t);
+		sink_endexpr(out, ")))\n");
+		return;
+	}
+
+	sink_printf(out, "(predicate (or_eq%d z n", size - 1);
+	for (int t = 1; t < size; t++) sink_printf(out, " a%d", t);
+	sink_puts(out, ") (iff z (or");
+	for (int t = 1; t < size; t++) sink_printf(out, " (= a%d n)", t);
+	sink_endexpr(out, ")))\n");
+
+	sink_endexpr(out, "(predicate (or_ne z a n) (iff z (and (!= a 0) (!= a n))))\n");
+}
+
+// Print out a call of the predicate for the definition of z_index (see fprint_decl_for_predicates()).
+static void fprint_call_of_predicate (sink_t *out, const data_t *data, int index, const char *connective, const runarg_t *arg)
+{
+	lit_t lits[data->size];
+
+	const int len = collect_literals(data->p, arg, lits);
+	assert(len > 0);
+
+	const bool conj = (strcmp(connective, "and") == 0);
+	const char symb = lits[0].symb;
+
+	if (conj && symb == 'y') {
+		sink_puts  (out, "(and_not");
+		sink_putint(out, len);
+		fprint_z_literal(out, index);
+		for (int pos = 0; pos < len; pos++) {
+			sink_putc(out, ' ');
+			fprint_name_of_y(out, lits[pos].I, lits[pos].J, lits[pos].N, lits[pos].K);
+		}
+		sink_endexpr(out, ")\n");
+
+	} else if (false == conj && symb == 'x' && data->encoding == ENCODING_ONEHOT) {
+		sink_puts  (out, "(or_p");
+		sink_putint(out, len);
+		fprint_z_literal(out, index);
+		for (int pos = 0; pos < len; pos++) {
+			sink_putc(out, ' ');
+			fprint_name_of_p(out, lits[pos].I, lits[pos].J, lits[pos].N, lits[pos].K);
+		}
+		sink_endexpr(out, ")\n");
+
+	} else if (false == conj && symb == 'x' && arg->type == 'v') {
+		// all numbers but testarg->N in the single cell
+		assert(len == data->size - 1);
+		sink_puts(out, "(or_ne");
+		fprint_z_literal(out, index);
+		fprint_name_of_x(out, arg->fixed_I, arg->fixed_J, arg->fixed_K);
+		sink_putc  (out, ' ');
+		sink_putint(out, arg->testarg->N);
+		sink_endexpr(out, ")\n");
+
+	} else if (false == conj && symb == 'x') {
+		// the number fixed_N in all cells but one of a group
+		sink_puts  (out, "(or_eq");
+		sink_putint(out, len);
+		fprint_z_literal(out, index);
+		sink_putint(out, arg->fixed_N);
+		for (int pos = 0; pos < len; pos++) {
+			sink_putc(out, ' ');
+			fprint_name_of_x(out, lits[pos].I, lits[pos].J, lits[pos].K);
+		}
+		sink_endexpr(out, ")\n");
+
+	} else {
+		assert(0); // no predicate for this shape
+		exit(EXIT_FAILURE);
+	}
 }
 
 void set_runarg (runarg_t *runarg,
@@ -1260,17 +2693,48 @@ bool test_not_in_column (const cur_t *cur, const testarg_t *arg)
 }
 
 // Print out primitive proposition for X or Y variable.
-void fprint_literal (FILE *out, char symb, int i, int j, int n, int k)
+// If the sink has a token table, the literal is copied from it.
+void fprint_literal (sink_t *out, char symb, int i, int j, int n, int k)
 {
 	assert(0 <= k);
 
+	toktab_t *tab = out->tokens;
+
+	if (tab == NULL) {
+		format_literal(out, symb, i, j, n, k);
+		return;
+	}
+
+	assert(k <= tab->bound);
+	if (tab->slice[k] == NULL) build_slice(tab, k);
+
+	const int *offset = tab->offset[k];
+	const int  t      = token_index(tab, symb, i, j, n);
+
+	sink_write(out, tab->slice[k] + offset[t], (size_t)(offset[t + 1] - offset[t]));
+}
+
+static void format_literal (sink_t *out, char symb, int i, int j, int n, int k)
+{
 	switch (symb) {
 		case 'x':
-			fprintf(out, " (= x_%d_%d_%d %d) ",   i, j, k, n);
+			if (out->onehot) {
+				sink_putc(out, ' ');
+				fprint_name_of_p(out, i, j, n, k);
+				sink_putc(out, ' ');
+				break;
+			}
+			sink_puts(out, " (= ");
+			fprint_name_of_x(out, i, j, k);
+			sink_putc(out, ' ');
+			sink_putint(out, n);
+			sink_puts(out, ") ");
 			break;
 
 		case 'y':
-			fprintf(out, " (not y_%d_%d_%d_%d) ", i, j, n, k); 
+			sink_puts(out, " (not ");
+			fprint_name_of_y(out, i, j, n, k);
+			sink_puts(out, ") ");
 			break;
 
 		default:
@@ -1279,3 +2743,372 @@ void fprint_literal (FILE *out, char symb, int i, int j, int n, int k)
 	}
 }
 
+void init_toktab (toktab_t *tab, int rank, int bound, const names_t *names, bool onehot, const data_t *clues)
+{
+	assert(0 <= bound);
+
+	tab->size   = rank * rank;
+	tab->bound  = bound;
+	tab->names  = names;
+	tab->onehot = onehot;
+	tab->clues  = clues;
+
+	tab->slice  = (char**)malloc(sizeof(char*) * (bound + 1));
+	tab->offset = (int **)malloc(sizeof(int *) * (bound + 1));
+	if (tab->slice == NULL || tab->offset == NULL) {
+		fprintf(stderr, "ERROR: Memory allocation failed.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	for (int k = 0; k <= bound; k++) {
+		tab->slice[k]  = NULL;
+		tab->offset[k] = NULL;
+	}
+}
+
+void delete_toktab (toktab_t *tab)
+{
+	for (int k = 0; k <= tab->bound; k++) {
+		free(tab->slice[k]);
+		free(tab->offset[k]);
+	}
+
+	free(tab->slice);
+	free(tab->offset);
+	tab->slice  = NULL;
+	tab->offset = NULL;
+}
+
+// Tokens are numbered in order of symbol (x, y), row, column, and number.
+static int token_index (const toktab_t *tab, char symb, int i, int j, int n)
+{
+	const int size = tab->size;
+
+	assert(symb == 'x' || symb == 'y');
+	assert(0 <= i && i < size);
+	assert(0 <= j && j < size);
+	assert(1 <= n && n <= size);
+
+	const int s = (symb == 'x' ? 0: 1);
+
+	return ((s * size + i) * size + j) * size + (n - 1);
+}
+
+// Serialize all tokens of step k.
+static void build_slice (toktab_t *tab, int k)
+{
+	const int size    = tab->size;
+	const int ntokens = 2 * size * size * size;
+
+	int *offset = (int*)malloc(sizeof(int) * (ntokens + 1));
+	if (offset == NULL) {
+		fprintf(stderr, "ERROR: Memory allocation failed.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	sink_t mem;
+	init_sink(&mem, NULL, false, false);
+	mem.names  = tab->names;
+	mem.onehot = tab->onehot;
+	mem.clues  = tab->clues;
+
+	const char symbs[2] = {'x', 'y'};
+	for (int s = 0; s < 2; s++) {
+		for (int i = 0; i < size; i++) {
+			for (int j = 0; j < size; j++) {
+				for (int n = 1; n <= size; n++) {
+					offset[token_index(tab, symbs[s], i, j, n)] = (int)mem.len;
+					format_literal(&mem, symbs[s], i, j, n, k);
+				}
+			}
+		}
+	}
+	offset[ntokens] = (int)mem.len;
+
+	char *slice = (char*)malloc(mem.len);
+	if (slice == NULL) {
+		fprintf(stderr, "ERROR: Memory allocation failed.\n");
+		exit(EXIT_FAILURE);
+	}
+	memcpy(slice, mem.buf, mem.len);
+
+	delete_sink(&mem);
+
+	tab->slice[k]  = slice;
+	tab->offset[k] = offset;
+}
+
+// Number X, Y and Z variables densely.
+// X and Y variables are numbered in the same order as fprint_decl_for_x() and fprint_decl_for_y(),
+// and only Z variables accepted by their strategies are numbered.
+// This must be called after all strategies are added.
+void init_names (names_t *names, data_t *data)
+{
+	const param_t *p = data->p;
+	const int size   = data->size;
+	const int rank   = data->rank;
+
+	names->rank  = rank;
+	names->size  = size;
+	names->bound = data->bound;
+	names->nx    = size * size * (data->bound + 1);
+	names->ny    = size * size * size * (data->bound + 1);
+	names->nz    = 0;
+
+	const int total = data->nissued;
+	names->zid  = (int*)   malloc(sizeof(int)    * total);
+	names->zsrc = (int*)   malloc(sizeof(int)    * total);
+	names->ztag = (stag_t*)malloc(sizeof(stag_t) * total);
+	if (names->zid == NULL || names->zsrc == NULL || names->ztag == NULL) {
+		fprintf(stderr, "ERROR: Memory allocation failed.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	for (int index = 0; index < total; index++) {
+		names->zid[index] = -1;
+	}
+
+	for (int pos = 0; pos < data->nstrats; pos++) {
+
+		idmgr_t *mgr = data->strat[pos].idmgr;
+		int *buf = (int*)malloc(sizeof(int) * (mgr->len));
+		if (buf == NULL) {
+			fprintf(stderr, "ERROR: Memory allocation failed.\n");
+			exit(EXIT_FAILURE);
+		}
+
+		const int first = mgr->first;
+		const int end   = mgr->first + mgr->total;
+
+		for (int index = first; index < end; index++) {
+			mgr->decoder(index, buf, rank, p, mgr);
+
+			if (true == mgr->accepted(buf, data)) {
+				const int id = names->nz++;
+				names->zid [index] = id;
+				names->zsrc[id]    = index;
+				names->ztag[id]    = data->strat[pos].tag;
+			}
+		}
+
+		free(buf);
+	}
+}
+
+void delete_names (names_t *names)
+{
+	free(names->zid);
+	free(names->zsrc);
+	free(names->ztag);
+	names->zid  = NULL;
+	names->zsrc = NULL;
+	names->ztag = NULL;
+}
+
+// Write the map from compact names to variables in binary,
+// where all fields but the magic are 32-bit integers in the host byte order:
+//
+// "SCGN" version rank bound nx ny nz
+// nx records of (i, j, k)    for x0, x1, ...
+// ny records of (i, j, n, k) for y0, y1, ...
+// nz records of (tag, m)     for z0, z1, ..., where z_m is the full name and tag identifies the strategy.
+//
+void fwrite_names (FILE *fp, const names_t *names)
+{
+	const int size = names->size;
+
+	int32_t head[6];
+	head[0] = SCG_NAMES_VERSION;
+	head[1] = names->rank;
+	head[2] = names->bound;
+	head[3] = names->nx;
+	head[4] = names->ny;
+	head[5] = names->nz;
+
+	bool done = (fwrite(SCG_NAMES_MAGIC, 1, 4, fp) == 4)
+		 && (fwrite(head, sizeof(int32_t), 6, fp) == 6);
+
+	for (int id = 0; done && id < names->nx; id++) {
+		int32_t rec[3];
+		rec[0] = id % size;                // i
+		rec[1] = (id / size) % size;       // j
+		rec[2] = id / (size * size);       // k
+		done = (fwrite(rec, sizeof(int32_t), 3, fp) == 3);
+	}
+
+	for (int id = 0; done && id < names->ny; id++) {
+		int32_t rec[4];
+		rec[0] = id % size;                       // i
+		rec[1] = (id / size) % size;              // j
+		rec[2] = (id / (size * size)) % size + 1; // n
+		rec[3] = id / (size * size * size);       // k
+		done = (fwrite(rec, sizeof(int32_t), 4, fp) == 4);
+	}
+
+	for (int id = 0; done && id < names->nz; id++) {
+		int32_t rec[2];
+		rec[0] = (int32_t)names->ztag[id];
+		rec[1] = names->zsrc[id];
+		done = (fwrite(rec, sizeof(int32_t), 2, fp) == 2);
+	}
+
+	if (false == done) {
+		fprintf(stderr, "ERROR: Cannot write the map of compact names.\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+// Print out Z variable as a positive literal.
+// z_index, or its body if it is inlined (see init_inliner()).
+void fprint_z_literal (sink_t *out, int index)
+{
+	const inliner_t *in = out->inliner;
+
+	sink_putc(out, ' ');
+	if (in != NULL && false == in->collecting && in->length[index] > 0) {
+		sink_write(out, in->bodies.buf + in->offset[index], in->length[index]);
+	} else {
+		fprint_name_of_z(out, index);
+	}
+	sink_putc(out, ' ');
+}
+
+// Print out the names of variables: x_i_j_k, y_i_j_n_k, and z_m,
+// or their compact names if the sink has ones.
+//
+// If the sink has clues, the variables of clue cells after step 0 are printed as those in step 0,
+// because clue cells never change.
+// In skeleton mode, both names are printed as alternatives, which are selected by splice_skeleton().
+void fprint_name_of_x (sink_t *out, int i, int j, int k)
+{
+	if (fprint_substituted(out, 'x', i, j, 0, &k)) return;
+
+	const names_t *names = out->names;
+	if (names != NULL) {
+		sink_putc  (out, 'x');
+		sink_putint(out, (k * names->size + j) * names->size + i);
+		return;
+	}
+
+	sink_puts(out, "x_");
+	sink_putint(out, i);
+	sink_putc(out, '_');
+	sink_putint(out, j);
+	sink_putc(out, '_');
+	sink_putint(out, k);
+}
+
+// Inverse of fprint_name_of_x(): set (i, j, k) and return true if name is the name of an X variable.
+bool parse_name_of_x (const char *name, const names_t *names, int size, int bound, int *i, int *j, int *k)
+{
+	if (names != NULL) {
+		char rest;
+		int  id;
+		if (sscanf(name, "x%d%c", &id, &rest) != 1) return false;
+		if (id < 0 || names->nx <= id)              return false;
+
+		*i = id % size;
+		*j = (id / size) % size;
+		*k = id / (size * size);
+		return true;
+	}
+
+	char rest;
+	if (sscanf(name, "x_%d_%d_%d%c", i, j, k, &rest) != 3) return false;
+
+	return 0 <= *i && *i < size
+	    && 0 <= *j && *j < size
+	    && 0 <= *k && *k <= bound;
+}
+
+void fprint_name_of_y (sink_t *out, int i, int j, int n, int k)
+{
+	if (fprint_substituted(out, 'y', i, j, n, &k)) return;
+
+	const names_t *names = out->names;
+	if (names != NULL) {
+		sink_putc  (out, 'y');
+		sink_putint(out, ((k * names->size + (n - 1)) * names->size + j) * names->size + i);
+		return;
+	}
+
+	sink_puts(out, "y_");
+	sink_putint(out, i);
+	sink_putc(out, '_');
+	sink_putint(out, j);
+	sink_putc(out, '_');
+	sink_putint(out, n);
+	sink_putc(out, '_');
+	sink_putint(out, k);
+}
+
+// Placement variables of the onehot encoding have no compact names.
+void fprint_name_of_p (sink_t *out, int i, int j, int n, int k)
+{
+	assert(out->names == NULL);
+
+	if (fprint_substituted(out, 'p', i, j, n, &k)) return;
+
+	sink_puts(out, "p_");
+	sink_putint(out, i);
+	sink_putc(out, '_');
+	sink_putint(out, j);
+	sink_putc(out, '_');
+	sink_putint(out, n);
+	sink_putc(out, '_');
+	sink_putint(out, k);
+}
+
+// Substitute step 0 for step k of a variable of a clue cell (see fprint_name_of_x()).
+// Return true if both names have been printed as alternatives in skeleton mode.
+static bool fprint_substituted (sink_t *out, char symb, int i, int j, int n, int *k)
+{
+	const data_t *data = out->clues;
+
+	if (data == NULL || *k == 0) return false;
+
+	const int cell = i * data->size + j;
+
+	if (false == data->skeleton) {
+		if (data->clue[cell]) *k = 0;
+		return false;
+	}
+
+	out->clues = NULL;
+
+	fprint_guard(out, SKEL_IF_CLUE, cell);
+	fprint_name_of_var(out, symb, i, j, n, 0);
+	fprint_guard(out, SKEL_ELSE, -1);
+	fprint_name_of_var(out, symb, i, j, n, *k);
+	fprint_guard(out, SKEL_END_IF, -1);
+
+	out->clues = data;
+	return true;
+}
+
+static void fprint_name_of_var (sink_t *out, char symb, int i, int j, int n, int k)
+{
+	switch (symb) {
+		case 'x': fprint_name_of_x(out, i, j, k);    break;
+		case 'y': fprint_name_of_y(out, i, j, n, k); break;
+		case 'p': fprint_name_of_p(out, i, j, n, k); break;
+		default:
+			assert(0);
+			exit(EXIT_FAILURE);
+	}
+}
+
+void fprint_name_of_z (sink_t *out, int index)
+{
+	const names_t *names = out->names;
+	if (names != NULL) {
+		assert(names->zid[index] >= 0);
+		sink_putc  (out, 'z');
+		sink_putint(out, names->zid[index]);
+		return;
+	}
+
+	sink_puts(out, "z_");
+	sink_putint(out, index);
+}
+
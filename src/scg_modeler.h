@@ -4,6 +4,9 @@
 #include<stdio.h>
 #include<stdlib.h>
 #include<stdbool.h>
+#include<time.h>
+#include<pthread.h>
+#include<zlib.h>
 
 #include "scg_tag.h"
 
@@ -13,10 +16,48 @@
 #define TYPE_ABBR (2)  // A: Block  B: Row
 #define TYPE_ABBC (3)  // A: Block  B: Column
 
+// Output formats
+#define FORMAT_SUGAR (0) // Sugar CSP
+#define FORMAT_CNF   (1) // DIMACS CNF
+#define FORMAT_SMT2  (2) // SMT-LIB2
+
+// Encodings of X variables
+#define ENCODING_INT    (0) // x_i_j_k is an integer variable ranging from 0 to size
+#define ENCODING_ONEHOT (1) // x_i_j_k = n is a boolean variable p_i_j_n_k (see fprint_decl_for_x())
+#define ENCODING_TIME   (2) // steps of placements and eliminations instead of states in all steps (see scg_timed.h)
+
 #define MAX_PARAMS (100) // maximum number of parameters
 #define MAX_STRATS (100) // maximum number of strategies
 
+#define SINK_BUFSIZE (1 << 22) // size of the write buffer of an output sink (4MB)
+#define SINK_NBUFS   (4)       // number of write buffers in threaded mode
+#define SINK_GZIP_LEVEL (1)    // compression level of gzip output: the output is repetitive enough.
+
+#define SCG_NAMES_MAGIC   "SCGN" // first bytes of the map of compact names
+#define SCG_NAMES_VERSION (1)
+
+#define SCG_SKELETON_VERSION (5) // format of skeletons and numbering of Z variables (see splice_skeleton())
+
+// cases of a cell, in which different constraints are printed (see first_case())
+#define CASE_NONE    (0)
+#define CASE_CLUE    (1)
+#define CASE_NONCLUE (2)
+
+// guards in skeletons
+#define SKEL_MARK     ('\x01') // beginning of a guard
+#define SKEL_MARK_END ('\x02') // end of a guard
+#define SKEL_ALWAYS   ('A')    // the following constraints are printed for any clues
+#define SKEL_CLUE     ('C')    // ... only if the cell is a clue cell
+#define SKEL_NONCLUE  ('N')    // ... only if the cell is not a clue cell
+#define SKEL_IF_CLUE  ('?')    // alternatives within a guard: the following bytes only if the cell is a clue cell,
+#define SKEL_ELSE     (':')    // ... the following bytes only if it is not,
+#define SKEL_END_IF   (';')    // ... and the following bytes as before SKEL_IF_CLUE
+
 typedef struct st_cell     cell_t;
+typedef struct st_sink     sink_t;
+typedef struct st_toktab   toktab_t;
+typedef struct st_names    names_t;
+typedef struct st_inliner  inliner_t;
 
 typedef struct st_data     data_t;
 typedef struct st_param    param_t;
@@ -26,6 +67,7 @@ typedef struct st_idmgr    idmgr_t;
 typedef struct st_runarg   runarg_t;
 typedef struct st_testarg  testarg_t;
 typedef struct st_cur      cur_t;
+typedef struct st_lit      lit_t;
 
 struct st_cur {
         int I;
@@ -34,17 +76,111 @@ struct st_cur {
 };
 
 
+// literal of an X or Y variable, as collected by collect_literals()
+struct st_lit {
+        char symb; // x: (= x_I_J_K N), y: (not y_I_J_N_K)
+        int  I;
+        int  J;
+        int  N;
+        int  K;
+};
+
 struct st_cell {
         int I;   // row index,   ranging from 0 to size - 1.
         int J;   // colum index, ranging from 0 to size - 1.
 };
 
+// output sink: all constraints are written through a large buffer,
+// which is flushed to the destination in big blocks.
+// In threaded mode, filled buffers are queued in a ring and written by
+// a background thread, so that generation and writing overlap.
+struct st_sink {
+        FILE  *fp;       // destination
+        char  *buf;      // write buffer being filled
+        size_t len;      // number of bytes held in buf
+        size_t cap;      // capacity of buf
+        long long nbytes; // total number of bytes flushed so far
+        long long nwritten; // total number of bytes written to the destination, after compression
+
+        bool      measuring; // only add up the widths of bytes, storing none of them (see init_measuring_sink())
+        long long nexprs;    // number of declarations and constraints ended so far (see sink_endexpr())
+
+        // consumer of flushed bytes instead of fp, or NULL (see init_filter_sink())
+        void (*consume) (void *arg, const char *buf, size_t len);
+        void  *consume_arg;
+
+        toktab_t *tokens; // tokens of X and Y literals, or NULL if literals are formatted each time
+        const names_t *names; // compact names of variables, or NULL for full names
+        bool onehot;      // whether X literals are printed as placement variables p_i_j_n_k
+        const data_t *clues; // clues whose variables after step 0 are printed as those in step 0, or NULL (see fprint_name_of_x())
+        inliner_t *inliner; // bodies printed in place of short Z variables, or NULL (see init_inliner())
+
+        char  *ring[SINK_NBUFS];     // all write buffers
+        size_t ring_len[SINK_NBUFS]; // number of bytes held in filled buffers
+        int    nbufs;    // number of allocated buffers
+        int    head;     // oldest filled buffer, written next
+        int    nfull;    // number of filled buffers waiting for the writer
+
+        bool   threaded; // whether the writer thread is running
+        bool   closing;  // no more buffers will be filled
+        bool   failed;   // whether a write error occurred
+        pthread_t       writer;
+        pthread_mutex_t lock; // protects head, nfull, closing and failed
+        pthread_cond_t  cond;
+
+        // used only by the writer, if the output is compressed
+        z_stream       zs;
+        unsigned char *zbuf; // compressed block, or NULL if the output is not compressed
+        size_t         zcap; // capacity of zbuf
+
+        // statistics in seconds, available after delete_sink()
+        struct timespec start;
+        double fill_time;  // spent on generating constraints
+        double wait_time;  // spent on waiting for an empty buffer
+        double write_time; // spent on writing to the destination
+};
+
+// interned tokens of X and Y literals, i.e., " (= x_i_j_k n) " and " (not y_i_j_n_k) ".
+// All tokens of step k are serialized in slice[k] when step k is used for the first time.
+struct st_toktab {
+        int size;
+        int bound;
+        const names_t *names; // names used in tokens, or NULL for full names
+        bool onehot;    // whether X literals are placement variables
+        const data_t *clues; // clues used in tokens, or NULL
+        char **slice;   // slice[k]: tokens of step k, or NULL if not built yet
+        int  **offset;  // offset[k][t]: beginning of the t-th token in slice[k]
+};
+
+// compact names of variables: X, Y, and Z variables are numbered densely
+// for each symbol in order of declaration, and printed as x<id>, y<id>, and z<id>.
+struct st_names {
+        int rank;
+        int size;
+        int bound;
+        int nx, ny, nz; // numbers of X, Y, and Z variables
+        int *zid;       // zid[m]: dense id of z_m, or -1 if z_m does not appear
+        int *zsrc;      // zsrc[d]: index m of the Z variable with dense id d
+        stag_t *ztag;   // ztag[d]: tag of the strategy which issued it
+};
+
+// short definitions of Z variables, whose bodies are printed in place of the variables,
+// so that the variables are neither declared nor defined.
+struct st_inliner {
+        int     limit;      // maximum number of literals of an inlined definition
+        bool    collecting; // whether bodies are being collected (see init_inliner())
+        size_t *offset;     // offset[m]: beginning of the body of z_m in bodies
+        size_t *length;     // length[m]: length of the body of z_m, or 0 if z_m is not inlined
+        size_t  end;        // end of the last body collected
+        sink_t  bodies;     // memory sink holding all bodies
+};
+
 struct st_strat {
         stag_t tag;
         idmgr_t *idmgr;
-        void (*fprint_literals_for_x) (FILE *, const data_t *);
-        void (*fprint_literals_for_y) (FILE *, const data_t *);
-        void (*fprint_cons_for_z)     (FILE *, data_t *);
+        void (*fprint_literals_for_x) (sink_t *, const data_t *);
+        void (*fprint_literals_for_y) (sink_t *, const data_t *);
+        void (*fprint_cons_for_z)     (sink_t *, data_t *);
 };
 
 // collection of all necessary data
@@ -57,6 +193,10 @@ struct st_data {
 
         cell_t *cs;  // array of clue cells, initialized with length size*size
         int nclues;
+        bool *clue;  // clue[i*size+j]: whether (i,j) is a clue cell
+
+        int *first_placed; // lower bounds of the steps of placements at cells, or NULL (see init_reach())
+        int *first_elim;   // ... and of eliminations of candidates
 
         param_t *p;    // combination of parameters
 
@@ -64,6 +204,20 @@ struct st_data {
 
         strat_t strat[MAX_STRATS]; // strategies
         int nstrats;
+
+        bool use_predicates; // print definitions of Z variables as calls of predicates
+        bool use_hints;      // print implied constraints for solvers (see fprint_cons_for_hints())
+        bool use_symmetry;   // restrict the numbers of clues to a canonical labelling (see fprint_cons_for_symmetry())
+        bool use_lex_leader; // find automorphisms of clue cells, and break them (see scg_symmetry.h)
+
+        int *generators;     // generators[g*nclues+t]: index in cs of the image of cs[t] by the g-th generator
+        int  ngenerators;    // number of generators of automorphisms of clue cells
+        int  encoding;       // ENCODING_INT, ENCODING_ONEHOT, or ENCODING_TIME
+        bool skeleton;       // print constraints for all clues under guards, ignoring cs (see first_case())
+        bool fused;          // one Z variable per (i,j,n,k) for the Sudoku rule and Hidden Singles,
+                             // defined by the disjunction of the conditions of the kinds or units
+        int  round;          // steps per round: 1, or one per strategy in sequential mode (see set_sequential())
+        stag_t phase[MAX_STRATS]; // phase[s]: the only strategy applied in the steps k with (k-1) % round == s
 };
 
 // combination of parameters
@@ -87,10 +241,13 @@ struct st_param {
 
 // id manager for variables linked to particular strategies
 struct st_idmgr {
-        int *pid;       // ids for parameters of such variables
-        int len;        // number of such parameters.
-        int first;      // first index that this manager issues
-        int total;      // total number of indices issued by this manager
+        int *pid;        // ids for parameters of such variables
+        int len;         // number of such parameters.
+        int first;       // first index that this manager issues
+        int total;       // total number of indices issued by this manager
+        int nslots;      // number of combinations of parameter values
+        int *id_of_slot; // index minus first of each combination, or -1 if it is never accepted
+        int *slot_of_id; // combination of each index minus first (see renumber_ids())
         void (*encoder) (const int *, int *, int, const param_t *, const idmgr_t *);
         void (*decoder) (int,         int *, int, const param_t *, const idmgr_t *);
         bool (*accepted)(const int *, const data_t *);
@@ -123,6 +280,35 @@ struct st_testarg {
 // functions for input/output
 extern void read_input (FILE *in, data_t *data);
 
+// functions for output sinks
+extern void init_sink    (sink_t *out, FILE *fp, bool threaded, bool compressed);
+extern void init_measuring_sink (sink_t *out);
+extern void init_filter_sink    (sink_t *out, void (*consume) (void *, const char *, size_t), void *arg);
+extern void delete_sink  (sink_t *out);
+extern void flush_sink   (sink_t *out);
+extern void sink_write   (sink_t *out, const char *s, size_t n);
+extern void sink_puts    (sink_t *out, const char *s);
+extern void sink_putc    (sink_t *out, char c);
+extern void sink_putint  (sink_t *out, int value);
+extern void sink_printf  (sink_t *out, const char *format, ...);
+extern void sink_endexpr (sink_t *out, const char *s);
+
+// functions for inlining of Z variables
+extern void init_inliner   (inliner_t *in, sink_t *out, data_t *data, int limit);
+extern void delete_inliner (inliner_t *in);
+
+// functions for token tables
+extern void init_toktab   (toktab_t *tab, int rank, int bound, const names_t *names, bool onehot, const data_t *clues);
+extern void delete_toktab (toktab_t *tab);
+
+// functions for compact names
+extern void init_names   (names_t *names, data_t *data);
+extern void delete_names (names_t *names);
+extern void fwrite_names (FILE *fp, const names_t *names);
+
+// functions for skeletons
+extern void splice_skeleton (sink_t *out, FILE *skel, const data_t *data);
+
 // functions for data
 extern void init_data   (data_t *data, int rank, int bound);
 extern void delete_data (data_t *data);
@@ -135,9 +321,12 @@ extern void add_strategy (data_t *data,
                         void (*encoder) (const int *, int *, int, const param_t *, const idmgr_t *),
                         void (*decoder) (int,         int *, int, const param_t *, const idmgr_t *),
                         bool (*accepted)(const int *, const data_t *),
-                        void (*fprint_literals_for_x) (FILE *, const data_t *),
-                        void (*fprint_literals_for_y) (FILE *, const data_t *),
-                        void (*fprint_cons_for_z)     (FILE *, data_t *));
+                        void (*fprint_literals_for_x) (sink_t *, const data_t *),
+                        void (*fprint_literals_for_y) (sink_t *, const data_t *),
+                        void (*fprint_cons_for_z)     (sink_t *, data_t *));
+
+extern void set_sequential  (data_t *data);
+extern bool applies_in_step (const data_t *data, stag_t tag, int k);
 
 extern void default_encoder (const int *value, int *index, int rank, const param_t *p, const idmgr_t *mgr);
 extern void default_decoder (int index,        int *value, int rank, const param_t *p, const idmgr_t *mgr);
@@ -166,30 +355,52 @@ extern void make_assoc_active (param_t *p, const idmgr_t *mgr);
 
 // functions for cells and blocks
 extern bool   is_clue_cell  (cell_t q, const cell_t *cs, int n);
+extern int    first_case    (sink_t *out, const data_t *data, cell_t q);
+extern int    next_case     (sink_t *out, const data_t *data, cell_t q, int c);
 extern bool   equal_cell    (cell_t q1, cell_t q2);
 extern bool   larger_cell   (cell_t q1, cell_t q2);
 extern cell_t cell_at       (int i, int j, int r);
 extern cell_t cell_in_block (int m, int n, int r);
 extern int    ownerblock    (cell_t q, int r);
 extern bool   is_in_block   (cell_t q, int n, int r);
+extern bool   is_in_group   (cell_t q, int group, char type, int rank);
 
 extern bool have_common_cell (int group_A, int group_B, int type_AB, int rank);
 
 // variable declarations
-extern void fprint_decl_for_x (FILE *out, data_t *data);
-extern void fprint_decl_for_y (FILE *out, data_t *data);
-extern void fprint_decl_for_z (FILE *out, data_t *data);
+extern void fprint_decl_for_x (sink_t *out, data_t *data);
+extern void fprint_decl_for_y (sink_t *out, data_t *data);
+extern void fprint_decl_for_z (sink_t *out, data_t *data);
 
 // state transition framework
-extern void fprint_cons_for_init  (FILE *out, data_t *data);
-extern void fprint_cons_for_trans (FILE *out, data_t *data);
-extern void fprint_cons_for_final (FILE *out, data_t *data);
-extern void fprint_cons_for_strat (FILE *out, data_t *data);
+extern void fprint_cons_for_init  (sink_t *out, data_t *data);
+extern void fprint_cons_for_trans (sink_t *out, data_t *data);
+extern void fprint_cons_for_final (sink_t *out, data_t *data);
+extern void fprint_cons_for_strat (sink_t *out, data_t *data);
+extern void fprint_cons_for_hints (sink_t *out, data_t *data);
+extern void fprint_cons_for_symmetry (sink_t *out, data_t *data);
+
+// definitions of Z variables
+extern void fprint_decl_for_predicates  (sink_t *out, const data_t *data);
+extern void fprint_definition_by_term   (sink_t *out, const data_t *data, int index, const runarg_t *arg);
+extern void fprint_definition_by_clause (sink_t *out, const data_t *data, int index, const runarg_t *arg);
+extern void fprint_definition_by_terms   (sink_t *out, const data_t *data, int index, const runarg_t *args, int nargs);
+extern void fprint_definition_by_clauses (sink_t *out, const data_t *data, int index, const runarg_t *args, int nargs);
 
 // functions for printing out boolean expressions
-extern void fprint_term   (FILE *out, const param_t *p, const runarg_t *arg);
-extern void fprint_clause (FILE *out, const param_t *p, const runarg_t *arg);
-extern void fprint_literal(FILE *out, char symb, int i, int j, int n, int k);
+extern void fprint_term   (sink_t *out, const param_t *p, const runarg_t *arg);
+extern void fprint_clause (sink_t *out, const param_t *p, const runarg_t *arg);
+extern void fprint_literal(sink_t *out, char symb, int i, int j, int n, int k);
+extern void fprint_literals_running_over (sink_t *out, const param_t *p, const runarg_t *arg);
+extern int  collect_literals (const param_t *p, const runarg_t *arg, lit_t *lits);
+extern void fprint_z_literal (sink_t *out, int index);
+extern void fprint_placed    (sink_t *out, const data_t *data, int i, int j, int k);
+
+extern void fprint_name_of_x (sink_t *out, int i, int j, int k);
+extern void fprint_name_of_y (sink_t *out, int i, int j, int n, int k);
+extern void fprint_name_of_p (sink_t *out, int i, int j, int n, int k);
+extern void fprint_name_of_z (sink_t *out, int index);
+extern bool parse_name_of_x  (const char *name, const names_t *names, int size, int bound, int *i, int *j, int *k);
 
 extern void set_runarg (runarg_t *runarg,
                         int i, int j, int n, int b, int k,
@@ -0,0 +1,210 @@
+#include <assert.h>
+#include <stdbool.h>
+
+#include "scg_reach.h"
+#include "scg_assert.h"
+
+static int  locked_bound (const data_t *data, const int *elim, int type_AB, int group_A, int group_B);
+static int  naked_bound  (const data_t *data, const int *placed, cell_t q, int locked);
+static bool is_peer      (cell_t q1, cell_t q2, int rank);
+
+static const char type_of_A[4] = {'r', 'c', 'b', 'b'}; // indexed by TYPE_ARBB, ..., TYPE_ABBC
+static const char type_of_B[4] = {'b', 'b', 'r', 'c'};
+
+// The bounds are the greatest solution of the following equations, which is approached from bound + 1 ("never"):
+//
+// placed(q) = 0 for a clue cell q, and otherwise the minimum of
+//             NS(q) + 1, where NS(q) is the least k such that size - 1 candidates of q can be eliminated in step k,
+//                              i.e., size - 1 peers of q are placed, or Locked Candidates applies to q, by then,
+//             max(elim(r)) + 1 over all cells r but q in the row, column, or block of q (Hidden Singles),
+// elim(q)   = the minimum of placed(r) over q and its peers r (Sudoku rule), and
+//             locked(A, B) over all groups A and B such that q is in A but not in B,
+//             where locked(A, B) = max(elim(r)) + 1 over all cells r in B but not in A (Locked Candidates).
+//
+// Every placement or elimination in step k follows from those in step k-1, or from placements in step k,
+// so that by induction on k, it never happens before these bounds.
+void init_reach (data_t *data)
+{
+        assert(data->first_placed == NULL);
+        assert(data->first_elim   == NULL);
+
+        const int size   = data->size;
+        const int rank   = data->rank;
+        const int ncells = size * size;
+        const int never  = data->bound + 1;
+
+        const bool NS = (get_idmgr(tag_NS, data) != NULL);
+        const bool HS = (get_idmgr(tag_HS, data) != NULL);
+        const bool LC = (get_idmgr(tag_LC, data) != NULL);
+
+        int *placed = (int*)malloc(sizeof(int) * ncells);
+        int *elim   = (int*)malloc(sizeof(int) * ncells);
+        if (placed == NULL || elim == NULL) {
+                fprintf(stderr, "ERROR: Memory allocation failed.\n");
+                exit(EXIT_FAILURE);
+        }
+
+        for (int c = 0; c < ncells; c++) {
+                placed[c] = data->clue[c] ? 0: never;
+                elim  [c] = never;
+        }
+
+        bool changed = true;
+        while (changed) {
+                changed = false;
+
+                for (int c = 0; c < ncells; c++) {
+                        const cell_t q = cell_at(c / size, c % size, rank);
+
+                        int locked = never;
+                        if (LC) {
+                                for (int type_AB = TYPE_ARBB; type_AB <= TYPE_ABBC; type_AB++) {
+                                        for (int group_A = 0; group_A < size; group_A++) {
+                                                if (false == is_in_group(q, group_A, type_of_A[type_AB], rank)) continue;
+
+                                                for (int group_B = 0; group_B < size; group_B++) {
+                                                        if (is_in_group(q, group_B, type_of_B[type_AB], rank))          continue;
+                                                        if (false == have_common_cell(group_A, group_B, type_AB, rank)) continue;
+
+                                                        const int b = locked_bound(data, elim, type_AB, group_A, group_B);
+                                                        if (b < locked) locked = b;
+                                                }
+                                        }
+                                }
+                        }
+
+                        int e = (placed[c] < locked ? placed[c]: locked);
+                        for (int d = 0; d < ncells; d++) {
+                                if (placed[d] < e && is_peer(q, cell_at(d / size, d % size, rank), rank)) e = placed[d];
+                        }
+
+                        int s = placed[c];
+                        if (false == data->clue[c]) {
+                                s = never;
+
+                                if (NS) {
+                                        const int b = naked_bound(data, placed, q, locked) + 1;
+                                        if (b < s) s = b;
+                                }
+
+                                if (HS) {
+                                        const char types[3] = {'r', 'c', 'b'};
+                                        const int  groups[3] = {q.I, q.J, ownerblock(q, rank)};
+
+                                        for (int t = 0; t < 3; t++) {
+                                                int b = 0;
+                                                for (int d = 0; d < ncells; d++) {
+                                                        const cell_t r = cell_at(d / size, d % size, rank);
+                                                        if (d != c && elim[d] > b && is_in_group(r, groups[t], types[t], rank)) b = elim[d];
+                                                }
+                                                if (b + 1 < s) s = b + 1;
+                                        }
+                                }
+
+                                if (s > never) s = never;
+                        }
+
+                        if (e < elim[c]) {
+                                elim[c] = e;
+                                changed = true;
+                        }
+
+                        if (s < placed[c]) {
+                                placed[c] = s;
+                                changed = true;
+                        }
+                }
+        }
+
+        data->first_placed = placed;
+        data->first_elim   = elim;
+}
+
+// Lower bound of the step at which a number is placed at q, or 0 if no bound is computed.
+int first_placement (const data_t *data, cell_t q)
+{
+        if (data->first_placed == NULL || data->skeleton) return 0;
+
+        return data->first_placed[q.I * data->size + q.J];
+}
+
+// Lower bound of the step at which some candidate of q is eliminated, or 0 if no bound is computed.
+int first_elimination (const data_t *data, cell_t q)
+{
+        if (data->first_elim == NULL || data->skeleton) return 0;
+
+        return data->first_elim[q.I * data->size + q.J];
+}
+
+// Whether a Z variable of a cell (I,J) in step K can be true,
+// where it places a number at the cell if placing, and eliminates a candidate of it otherwise.
+// Z variables without I, J, or K are always reachable.
+bool reachable (const int *buf, const idmgr_t *mgr, const data_t *data, bool placing)
+{
+        const int pos_I = pos_of_pid(data->pid_I, mgr);
+        const int pos_J = pos_of_pid(data->pid_J, mgr);
+        const int pos_K = pos_of_pid(data->pid_K, mgr);
+
+        if (pos_I < 0 || pos_J < 0 || pos_K < 0) return true;
+
+        const cell_t q = cell_at(buf[pos_I], buf[pos_J], data->rank);
+
+        return buf[pos_K] >= (placing ? first_placement(data, q): first_elimination(data, q));
+}
+
+// Lower bound of the step at which n is locked in A for Locked Candidates,
+// i.e., its Z variable can be true, or 0 if no bound is computed.
+int first_locked (const data_t *data, int type_AB, int group_A, int group_B)
+{
+        if (data->first_elim == NULL || data->skeleton) return 0;
+
+        return locked_bound(data, data->first_elim, type_AB, group_A, group_B);
+}
+
+// max(elim(r)) + 1 over all cells r in B but not in A, bounded by bound + 1.
+static int locked_bound (const data_t *data, const int *elim, int type_AB, int group_A, int group_B)
+{
+        const int size  = data->size;
+        const int rank  = data->rank;
+        const int never = data->bound + 1;
+
+        int b = 0;
+        for (int d = 0; d < size * size; d++) {
+                const cell_t r = cell_at(d / size, d % size, rank);
+
+                if (false == is_in_group(r, group_B, type_of_B[type_AB], rank)) continue;
+                if (is_in_group(r, group_A, type_of_A[type_AB], rank))          continue;
+
+                if (elim[d] > b) b = elim[d];
+        }
+
+        return (b + 1 < never ? b + 1: never);
+}
+
+// The least k such that size - 1 candidates of q can be eliminated in step k,
+// where each peer placed by then eliminates at most one candidate,
+// and Locked Candidates any number of candidates from the step locked.
+static int naked_bound (const data_t *data, const int *placed, cell_t q, int locked)
+{
+        const int size  = data->size;
+        const int rank  = data->rank;
+        const int never = data->bound + 1;
+
+        for (int k = 0; k < never && k < locked; k++) {
+                int count = 0;
+                for (int d = 0; d < size * size; d++) {
+                        if (placed[d] <= k && is_peer(q, cell_at(d / size, d % size, rank), rank)) count++;
+                }
+
+                if (count >= size - 1) return k;
+        }
+
+        return (locked < never ? locked: never);
+}
+
+static bool is_peer (cell_t q1, cell_t q2, int rank)
+{
+        if (equal_cell(q1, q2)) return false;
+
+        return q1.I == q2.I || q1.J == q2.J || ownerblock(q1, rank) == ownerblock(q2, rank);
+}
@@ -0,0 +1,20 @@
+#ifndef SCG_REACH_H
+#define SCG_REACH_H
+
+#include "scg_modeler.h"
+
+// Static lower bounds of the steps at which a number can be placed at a cell, or a candidate of it eliminated,
+// derived from the positions of clues and the enabled strategies, whatever the numbers of clues are.
+// Because the numbers are unknown, the bounds are the same for all candidates of a cell.
+//
+// With these bounds, X and Y variables before them are fixed, and Z variables before them are not accepted,
+// so that they neither are defined nor appear in constraints (see fprint_cons_for_trans()).
+// This must be called after all strategies are added, and is not for skeleton mode.
+extern void init_reach (data_t *data);
+
+extern int  first_placement   (const data_t *data, cell_t q);
+extern int  first_elimination (const data_t *data, cell_t q);
+extern bool reachable         (const int *buf, const idmgr_t *mgr, const data_t *data, bool placing);
+extern int  first_locked      (const data_t *data, int type_AB, int group_A, int group_B);
+
+#endif /*SCG_REACH_H*/
@@ -0,0 +1,110 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "scg_sexp.h"
+
+static void append_char (sexp_reader_t *reader, char c);
+
+void init_sexp_reader (sexp_reader_t *reader,
+                        void (*on_expr)    (void *, const char *, size_t),
+                        void (*on_comment) (void *, const char *, size_t),
+                        void *arg)
+{
+        reader->on_expr    = on_expr;
+        reader->on_comment = on_comment;
+        reader->arg        = arg;
+
+        reader->depth      = 0;
+        reader->in_comment = false;
+        reader->len        = 0;
+        reader->cap        = BUFSIZ;
+
+        reader->text = (char*)malloc(reader->cap);
+        if (reader->text == NULL) {
+                fprintf(stderr, "ERROR: Memory allocation failed.\n");
+                exit(EXIT_FAILURE);
+        }
+}
+
+void delete_sexp_reader (sexp_reader_t *reader)
+{
+        free(reader->text);
+        reader->text = NULL;
+}
+
+// Hand complete expressions and comments in buf over to the callbacks,
+// and keep the last incomplete one until the next call.
+// Note: used as the consumer of a filter sink.
+void feed_sexp_reader (void *arg, const char *buf, size_t len)
+{
+        sexp_reader_t *reader = (sexp_reader_t*)arg;
+
+        for (size_t pos = 0; pos < len; pos++) {
+                char c = buf[pos];
+
+                if (reader->in_comment) {
+                        if (c == '\n') {
+                                reader->text[reader->len] = '\0';
+                                reader->on_comment(reader->arg, reader->text, reader->len);
+                                reader->len = 0;
+                                reader->in_comment = false;
+                        } else {
+                                append_char(reader, c);
+                        }
+                        continue;
+                }
+
+                if (reader->depth == 0 && c != '(') {
+                        if (c == ';') {
+                                reader->in_comment = true;
+                        } else if (c != ' ' && c != '\n') {
+                                fprintf(stderr, "ERROR: Cannot parse constraints at %.*s\n",
+                                                (int)(len - pos < 80 ? len - pos: 80), buf + pos);
+                                exit(EXIT_FAILURE);
+                        }
+                        continue;
+                }
+
+                if (c == '\n') c = ' ';
+                append_char(reader, c);
+
+                if (c == '(') {
+                        reader->depth++;
+                } else if (c == ')' && --(reader->depth) == 0) {
+                        reader->text[reader->len] = '\0';
+                        reader->on_expr(reader->arg, reader->text, reader->len);
+                        reader->len = 0;
+                }
+        }
+}
+
+// Hand the last comment over, if it does not end with a newline.
+void finish_sexp_reader (sexp_reader_t *reader)
+{
+        if (reader->depth > 0) {
+                fprintf(stderr, "ERROR: Constraints end in the middle of an expression.\n");
+                exit(EXIT_FAILURE);
+        }
+
+        if (reader->in_comment) {
+                reader->text[reader->len] = '\0';
+                reader->on_comment(reader->arg, reader->text, reader->len);
+                reader->len = 0;
+                reader->in_comment = false;
+        }
+}
+
+static void append_char (sexp_reader_t *reader, char c)
+{
+        if (reader->len + 1 == reader->cap) { // room for the terminator
+                reader->cap *= 2;
+                reader->text = (char*)realloc(reader->text, reader->cap);
+                if (reader->text == NULL) {
+                        fprintf(stderr, "ERROR: Memory allocation failed.\n");
+                        exit(EXIT_FAILURE);
+                }
+        }
+
+        reader->text[reader->len++] = c;
+}
@@ -0,0 +1,34 @@
+#ifndef SCG_SEXP_H
+#define SCG_SEXP_H
+
+#include<stdio.h>
+#include<stdlib.h>
+#include<stdbool.h>
+
+typedef struct st_sexp_reader sexp_reader_t;
+
+// reader of constraints in the Sugar format, used to translate them into other formats.
+// Bytes are fed through a filter sink (see feed_sexp_reader()), and each top-level expression
+// and each comment is handed over to the callbacks as soon as it is complete.
+// An expression may span lines: newlines in it are replaced by spaces.
+struct st_sexp_reader {
+        void (*on_expr)    (void *arg, const char *expr, size_t len); // expr[len] is '\0'
+        void (*on_comment) (void *arg, const char *text, size_t len); // text after ';', without the newline
+        void  *arg;
+
+        int    depth;      // depth of parentheses in the expression being read
+        bool   in_comment; // whether a comment is being read
+        char  *text;       // expression or comment being read
+        size_t len;
+        size_t cap;
+};
+
+extern void init_sexp_reader   (sexp_reader_t *reader,
+                                void (*on_expr)    (void *, const char *, size_t),
+                                void (*on_comment) (void *, const char *, size_t),
+                                void *arg);
+extern void delete_sexp_reader (sexp_reader_t *reader);
+extern void feed_sexp_reader   (void *reader, const char *buf, size_t len);
+extern void finish_sexp_reader (sexp_reader_t *reader);
+
+#endif /*SCG_SEXP_H*/
@@ -0,0 +1,215 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "scg_smt2.h"
+
+static void translate_comment (void *arg, const char *text, size_t len);
+static void translate_expr    (void *arg, const char *expr, size_t len);
+static void print_term        (sink_t *out, const char *s, const char *end);
+static void define_predicate  (sink_t *out, const char *s, const char *end);
+static bool is_int_param      (const char *name, size_t len, const char *body, const char *end);
+static const char *token_end  (const char *s, const char *end);
+static const char *skip_space (const char *s, const char *end);
+
+static void broken (const char *expr, size_t len);
+
+void init_smt2 (smt2_t *smt2, const data_t *data, sink_t *out)
+{
+        smt2->data = data;
+        smt2->out  = out;
+        init_sexp_reader(&(smt2->reader), translate_expr, translate_comment, smt2);
+
+        sink_puts(out, "(set-option :produce-models true)\n");
+        sink_puts(out, "(set-logic QF_LIA)\n");
+}
+
+void delete_smt2 (smt2_t *smt2)
+{
+        delete_sexp_reader(&(smt2->reader));
+}
+
+// Check satisfiability, and ask for the values of X variables in step 0, i.e., the clues,
+// or those of placement variables in the onehot encoding.
+void finish_smt2 (smt2_t *smt2)
+{
+        finish_sexp_reader(&(smt2->reader));
+
+        sink_t *out = smt2->out;
+        const int size = smt2->data->size;
+
+        sink_puts(out, "(check-sat)\n");
+        sink_puts(out, "(get-value (");
+        for (int i = 0; i < size; i++) {
+                for (int j = 0; j < size; j++) {
+                        if (smt2->data->encoding == ENCODING_ONEHOT) {
+                                for (int n = 1; n <= size; n++) {
+                                        sink_putc(out, ' ');
+                                        fprint_name_of_p(out, i, j, n, 0);
+                                }
+                                continue;
+                        }
+                        sink_putc(out, ' ');
+                        fprint_name_of_x(out, i, j, 0);
+                }
+        }
+        sink_puts(out, "))\n");
+        sink_puts(out, "(exit)\n");
+}
+
+static void translate_comment (void *arg, const char *text, size_t len)
+{
+        smt2_t *smt2 = (smt2_t*)arg;
+
+        sink_putc(smt2->out, ';');
+        sink_write(smt2->out, text, len);
+        sink_putc(smt2->out, '\n');
+}
+
+// (int x min max) ---> (declare-fun x () Int) (assert (<= min x max))
+// (bool y)        ---> (declare-fun y () Bool)
+// (predicate ...) ---> (define-fun ...)
+// constraint c    ---> (assert c')
+static void translate_expr (void *arg, const char *expr, size_t len)
+{
+        smt2_t *smt2 = (smt2_t*)arg;
+        sink_t *out  = smt2->out;
+
+        const char *end = expr + len;
+        const char *op  = skip_space(expr + 1, end);
+        const char *p   = token_end(op, end);
+        const size_t oplen = p - op;
+
+        if ((oplen == 3 && memcmp(op, "int", 3) == 0) || (oplen == 4 && memcmp(op, "bool", 4) == 0)) {
+                const char *name = skip_space(p, end);
+                const char *q    = token_end(name, end);
+                if (q == name) broken(expr, len);
+
+                sink_puts (out, "(declare-fun ");
+                sink_write(out, name, q - name);
+                sink_puts (out, op[0] == 'i' ? " () Int)\n": " () Bool)\n");
+
+                if (op[0] == 'i') {
+                        char *r;
+                        const long min = strtol(q, &r, 10);
+                        const long max = strtol(r, &r, 10);
+
+                        sink_puts  (out, "(assert (<= ");
+                        sink_putint(out, (int)min);
+                        sink_putc  (out, ' ');
+                        sink_write (out, name, q - name);
+                        sink_putc  (out, ' ');
+                        sink_putint(out, (int)max);
+                        sink_puts  (out, "))\n");
+                }
+                return;
+        }
+
+        if (oplen == 9 && memcmp(op, "predicate", 9) == 0) {
+                define_predicate(out, p, end - 1);
+                return;
+        }
+
+        sink_puts(out, "(assert ");
+        print_term(out, expr, end);
+        sink_puts(out, ")\n");
+}
+
+// Print out a term with the operators of Sugar renamed:
+// iff ---> =, imp ---> =>, != ---> distinct, and the others as they are.
+static void print_term (sink_t *out, const char *s, const char *end)
+{
+        while (s < end) {
+                const char *p = memchr(s, '(', end - s);
+                if (p == NULL) {
+                        sink_write(out, s, end - s);
+                        return;
+                }
+                sink_write(out, s, p + 1 - s);
+
+                const char *op = skip_space(p + 1, end);
+                const char *q  = token_end(op, end);
+                const size_t oplen = q - op;
+
+                sink_write(out, p + 1, op - (p + 1));
+                if      (oplen == 3 && memcmp(op, "iff", 3) == 0) sink_puts(out, "=");
+                else if (oplen == 3 && memcmp(op, "imp", 3) == 0) sink_puts(out, "=>");
+                else if (oplen == 2 && memcmp(op, "!=",  2) == 0) sink_puts(out, "distinct");
+                else    sink_write(out, op, oplen);
+
+                s = q;
+        }
+}
+
+// (predicate (name a1 ... am) body) ---> (define-fun name ((a1 T1) ... (am Tm)) Bool body'),
+// where Ti is Int if ai is compared by = or !=, and Bool otherwise.
+// Note: s points just after "predicate", and end at the last parenthesis.
+static void define_predicate (sink_t *out, const char *s, const char *end)
+{
+        const char *head = skip_space(s, end);
+        if (head == end || *head != '(') broken(s, end - s);
+
+        const char *close = memchr(head, ')', end - head);
+        if (close == NULL) broken(s, end - s);
+
+        const char *body = close + 1;
+
+        const char *name = skip_space(head + 1, close);
+        const char *p    = token_end(name, close);
+
+        sink_puts (out, "(define-fun ");
+        sink_write(out, name, p - name);
+        sink_puts (out, " (");
+
+        for (p = skip_space(p, close); p < close; p = skip_space(p, close)) {
+                const char *q = token_end(p, close);
+
+                sink_putc (out, '(');
+                sink_write(out, p, q - p);
+                sink_puts (out, is_int_param(p, q - p, body, end) ? " Int) ": " Bool) ");
+
+                p = q;
+        }
+
+        sink_puts(out, ") Bool ");
+        print_term(out, body, end);
+        sink_puts(out, ")\n");
+}
+
+// Whether a parameter appears in some comparison (= a b) or (!= a b) in body.
+static bool is_int_param (const char *name, size_t len, const char *body, const char *end)
+{
+        for (const char *p = body; (p = memchr(p, '(', end - p)) != NULL; ) {
+                const char *op = skip_space(p + 1, end);
+                const char *q  = token_end(op, end);
+                p = q;
+
+                if (false == ((q - op == 1 && op[0] == '=') || (q - op == 2 && memcmp(op, "!=", 2) == 0))) continue;
+
+                for (int pos = 0; pos < 2; pos++) {
+                        const char *a = skip_space(q, end);
+                        q = token_end(a, end);
+                        if ((size_t)(q - a) == len && memcmp(a, name, len) == 0) return true;
+                }
+        }
+
+        return false;
+}
+
+static const char *token_end (const char *s, const char *end)
+{
+        while (s < end && *s != ' ' && *s != '(' && *s != ')') s++;
+        return s;
+}
+
+static const char *skip_space (const char *s, const char *end)
+{
+        while (s < end && *s == ' ') s++;
+        return s;
+}
+
+static void broken (const char *expr, size_t len)
+{
+        fprintf(stderr, "ERROR: Cannot parse %.*s\n", (int)(len < 80 ? len: 80), expr);
+        exit(EXIT_FAILURE);
+}
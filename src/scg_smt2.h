@@ -0,0 +1,23 @@
+#ifndef SCG_SMT2_H
+#define SCG_SMT2_H
+
+#include "scg_modeler.h"
+#include "scg_sexp.h"
+
+typedef struct st_smt2 smt2_t;
+
+// translator of constraints in the Sugar format into SMT-LIB2 (QF_LIA).
+// Constraints are fed through a filter sink into the reader, and translated expression by expression:
+// X variables are declared as integers, Y and Z variables as booleans,
+// predicates are defined by define-fun, and the other expressions are asserted.
+struct st_smt2 {
+        const data_t *data;
+        sink_t *out;     // destination of SMT-LIB2
+        sexp_reader_t reader;
+};
+
+extern void init_smt2   (smt2_t *smt2, const data_t *data, sink_t *out);
+extern void delete_smt2 (smt2_t *smt2);
+extern void finish_smt2 (smt2_t *smt2);
+
+#endif /*SCG_SMT2_H*/
@@ -0,0 +1,380 @@
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "scg_symmetry.h"
+
+#define MAX_AUTOMORPHISMS (256)     // automorphisms found at most, and elements of the group generated by them
+#define MAX_SEARCH_NODES  (1 << 20) // partial maps of rows and columns tried at most
+
+// state of the search for automorphisms, which maps the rows of src first, and then its columns
+typedef struct st_search {
+        const data_t *data;
+        int  size;
+        int  rank;
+        bool transposed;
+
+        bool *src;          // src[i*size+j]: whether (i,j) is a clue cell, or (j,i) if transposed
+        int  *src_count;    // src_count[i]: number of clue cells in row i of src
+        int  *dst_count;    // dst_count[i]: number of clue cells in row i
+        uint64_t *src_mask; // src_mask[j]: images of the rows of the clue cells in column j of src
+        uint64_t *dst_mask; // dst_mask[j]: rows of the clue cells in column j
+        int  *index_of;     // index_of[i*size+j]: index of (i,j) in cs, or -1
+
+        int  *row;          // row[i]: image of row i of src
+        int  *col;          // col[j]: image of column j of src
+        bool *used_row;
+        bool *used_col;
+        bool *used_band;
+        bool *used_stack;
+
+        int  *perm;         // perm[a*nclues+t]: index in cs of the image of cs[t] by the a-th automorphism
+        int   nperms;
+        long  nodes;
+} search_t;
+
+static void map_rows    (search_t *s, int i);
+static void map_columns (search_t *s, int j);
+static void record      (search_t *s);
+static int  select_generators (const int *perm, int nperms, int m, int *gens);
+static bool contains    (const int *elems, int nelems, const int *p, int m);
+static int  find_root   (int *parent, int t);
+static void fprint_equal      (sink_t *out, const data_t *data, int a, int b);
+static void fprint_not_larger (sink_t *out, const data_t *data, int a, int b);
+
+// The search gives up after MAX_SEARCH_NODES, or MAX_AUTOMORPHISMS automorphisms,
+// which is sound because the constraints for any of them hold in the least model of each orbit.
+void find_automorphisms (data_t *data)
+{
+        assert(data->generators == NULL);
+
+        const int size   = data->size;
+        const int ncells = size * size;
+        const int m      = data->nclues;
+
+        data->ngenerators = 0;
+        if (m == 0 || size > 64) return; // the images of rows are held in 64 bits.
+
+        search_t s;
+        s.data = data;
+        s.size = size;
+        s.rank = data->rank;
+
+        s.src        = (bool*)malloc(sizeof(bool) * ncells);
+        s.src_count  = (int*)malloc(sizeof(int) * size);
+        s.dst_count  = (int*)malloc(sizeof(int) * size);
+        s.src_mask   = (uint64_t*)malloc(sizeof(uint64_t) * size);
+        s.dst_mask   = (uint64_t*)malloc(sizeof(uint64_t) * size);
+        s.index_of   = (int*)malloc(sizeof(int) * ncells);
+        s.row        = (int*)malloc(sizeof(int) * size);
+        s.col        = (int*)malloc(sizeof(int) * size);
+        s.used_row   = (bool*)calloc(size, sizeof(bool));
+        s.used_col   = (bool*)calloc(size, sizeof(bool));
+        s.used_band  = (bool*)calloc(size, sizeof(bool));
+        s.used_stack = (bool*)calloc(size, sizeof(bool));
+        s.perm       = (int*)malloc(sizeof(int) * MAX_AUTOMORPHISMS * m);
+        if (s.src == NULL || s.src_count == NULL || s.dst_count == NULL || s.src_mask == NULL || s.dst_mask == NULL
+         || s.index_of == NULL || s.row == NULL || s.col == NULL || s.used_row == NULL || s.used_col == NULL
+         || s.used_band == NULL || s.used_stack == NULL || s.perm == NULL) {
+                fprintf(stderr, "ERROR: Memory allocation failed.\n");
+                exit(EXIT_FAILURE);
+        }
+        s.nperms = 0;
+        s.nodes  = 0;
+
+        for (int c = 0; c < ncells; c++) s.index_of[c] = -1;
+        for (int t = 0; t < m; t++) s.index_of[data->cs[t].I * size + data->cs[t].J] = t;
+
+        for (int i = 0; i < size; i++) {
+                s.dst_count[i] = 0;
+                s.dst_mask[i]  = 0;
+        }
+        for (int c = 0; c < ncells; c++) {
+                if (false == data->clue[c]) continue;
+                s.dst_count[c / size]++;
+                s.dst_mask[c % size] |= ((uint64_t)1 << (c / size));
+        }
+
+        for (int transposed = 0; transposed <= 1; transposed++) {
+                s.transposed = transposed;
+
+                for (int i = 0; i < size; i++) {
+                        s.src_count[i] = 0;
+                        for (int j = 0; j < size; j++) {
+                                s.src[i * size + j] = transposed ? data->clue[j * size + i]: data->clue[i * size + j];
+                                if (s.src[i * size + j]) s.src_count[i]++;
+                        }
+                }
+
+                map_rows(&s, 0);
+        }
+
+        int *gens = (int*)malloc(sizeof(int) * (s.nperms + 1) * m);
+        if (gens == NULL) {
+                fprintf(stderr, "ERROR: Memory allocation failed.\n");
+                exit(EXIT_FAILURE);
+        }
+        data->ngenerators = select_generators(s.perm, s.nperms, m, gens);
+        data->generators  = gens;
+
+        free(s.src);
+        free(s.src_count);
+        free(s.dst_count);
+        free(s.src_mask);
+        free(s.dst_mask);
+        free(s.index_of);
+        free(s.row);
+        free(s.col);
+        free(s.used_row);
+        free(s.used_col);
+        free(s.used_band);
+        free(s.used_stack);
+        free(s.perm);
+}
+
+// Map row i of src, where a band is mapped to a band with its first row,
+// and the others of the band into the same band.
+static void map_rows (search_t *s, int i)
+{
+        if (s->nodes++ > MAX_SEARCH_NODES || s->nperms == MAX_AUTOMORPHISMS) return;
+
+        const int size = s->size;
+        const int rank = s->rank;
+
+        if (i == size) {
+                for (int j = 0; j < size; j++) {
+                        s->src_mask[j] = 0;
+                        for (int r = 0; r < size; r++) {
+                                if (s->src[r * size + j]) s->src_mask[j] |= ((uint64_t)1 << s->row[r]);
+                        }
+                }
+                map_columns(s, 0);
+                return;
+        }
+
+        const bool first = (i % rank == 0);
+        const int  from  = first ? 0: s->row[i - 1] / rank;
+        const int  to    = first ? rank: from + 1;
+
+        for (int band = from; band < to; band++) {
+                if (first && s->used_band[band]) continue;
+
+                for (int u = 0; u < rank; u++) {
+                        const int target = band * rank + u;
+                        if (s->used_row[target] || s->src_count[i] != s->dst_count[target]) continue;
+
+                        s->row[i] = target;
+                        s->used_row[target] = true;
+                        if (first) s->used_band[band] = true;
+
+                        map_rows(s, i + 1);
+
+                        s->used_row[target] = false;
+                        if (first) s->used_band[band] = false;
+                }
+        }
+}
+
+// Map column j of src in the same way, where its clue cells must be mapped onto those of the image.
+static void map_columns (search_t *s, int j)
+{
+        if (s->nodes++ > MAX_SEARCH_NODES || s->nperms == MAX_AUTOMORPHISMS) return;
+
+        const int rank = s->rank;
+
+        if (j == s->size) {
+                record(s);
+                return;
+        }
+
+        const bool first = (j % rank == 0);
+        const int  from  = first ? 0: s->col[j - 1] / rank;
+        const int  to    = first ? rank: from + 1;
+
+        for (int stack = from; stack < to; stack++) {
+                if (first && s->used_stack[stack]) continue;
+
+                for (int u = 0; u < rank; u++) {
+                        const int target = stack * rank + u;
+                        if (s->used_col[target] || s->src_mask[j] != s->dst_mask[target]) continue;
+
+                        s->col[j] = target;
+                        s->used_col[target] = true;
+                        if (first) s->used_stack[stack] = true;
+
+                        map_columns(s, j + 1);
+
+                        s->used_col[target] = false;
+                        if (first) s->used_stack[stack] = false;
+                }
+        }
+}
+
+// Record the automorphism as a permutation of the indices of clue cells, unless it is the identity or known.
+// A clue cell (i,j) is (i,j) of src, or (j,i) if transposed, which is mapped to (row[i], col[j]).
+static void record (search_t *s)
+{
+        const data_t *data = s->data;
+
+        const int size = s->size;
+        const int m    = data->nclues;
+
+        int *p = s->perm + s->nperms * m;
+
+        bool identity = true;
+        for (int t = 0; t < m; t++) {
+                const cell_t q = data->cs[t];
+                const int i = s->transposed ? q.J: q.I;
+                const int j = s->transposed ? q.I: q.J;
+
+                p[t] = s->index_of[s->row[i] * size + s->col[j]];
+                assert(p[t] >= 0);
+
+                if (p[t] != t) identity = false;
+        }
+
+        if (identity || contains(s->perm, s->nperms, p, m)) return;
+
+        s->nperms++;
+}
+
+// Select automorphisms which are not generated by those selected before, as far as the group is enumerated,
+// and return their number.
+static int select_generators (const int *perm, int nperms, int m, int *gens)
+{
+        int *elems = (int*)malloc(sizeof(int) * MAX_AUTOMORPHISMS * m);
+        if (elems == NULL) {
+                fprintf(stderr, "ERROR: Memory allocation failed.\n");
+                exit(EXIT_FAILURE);
+        }
+
+        for (int t = 0; t < m; t++) elems[t] = t;
+        int nelems = 1;
+        int ngens  = 0;
+
+        for (int a = 0; a < nperms; a++) {
+                const int *p = perm + a * m;
+                if (contains(elems, nelems, p, m)) continue;
+
+                memcpy(gens + ngens * m, p, sizeof(int) * m);
+                ngens++;
+
+                // close the elements under the generators, unless there are too many.
+                for (int e = 0; e < nelems; e++) {
+                        for (int g = 0; g < ngens; g++) {
+                                int c[m];
+                                for (int t = 0; t < m; t++) c[t] = gens[g * m + elems[e * m + t]];
+
+                                if (contains(elems, nelems, c, m)) continue;
+                                if (nelems == MAX_AUTOMORPHISMS) {
+                                        free(elems);
+                                        return ngens;
+                                }
+                                memcpy(elems + nelems * m, c, sizeof(int) * m);
+                                nelems++;
+                        }
+                }
+        }
+
+        free(elems);
+        return ngens;
+}
+
+static bool contains (const int *elems, int nelems, const int *p, int m)
+{
+        for (int e = 0; e < nelems; e++) {
+                if (memcmp(elems + e * m, p, sizeof(int) * m) == 0) return true;
+        }
+        return false;
+}
+
+// For each generator p, the numbers of clues v_0, ..., v_m-1 in the order of cs are lexicographically
+// not larger than v_p[0], ..., v_p[m-1]: for each t moved by p,
+//
+// (imp (and (= v_s v_p[s]) ...) (<= v_t v_p[t])) over all s < t moved by p,
+//
+// where equalities and inequalities are expanded into literals (= x_i_j_0 n) for all formats.
+// A constraint is omitted if the equalities before it imply (= v_t v_p[t]), e.g., for the second cell of a swap.
+void fprint_cons_for_lex_leader (sink_t *out, data_t *data)
+{
+        if (false == data->use_lex_leader) return;
+        assert(false == data->skeleton);
+
+        sink_puts(out, ";\n");
+        sink_puts(out, "; Lex-Leader Constraints for Automorphisms of Clue Cells\n");
+        sink_printf(out, "; number of generators = %d\n", data->ngenerators);
+
+        const int m = data->nclues;
+
+        int parent[m]; // classes of the numbers which are equal by the equalities before t
+
+        for (int g = 0; g < data->ngenerators; g++) {
+                const int *p = data->generators + g * m;
+
+                for (int t = 0; t < m; t++) parent[t] = t;
+
+                bool first = true;
+                for (int t = 0; t < m; t++) {
+                        const int a = find_root(parent, t);
+                        const int b = find_root(parent, p[t]);
+                        if (a == b) continue;
+                        parent[a] = b;
+
+                        if (first) {
+                                fprint_not_larger(out, data, t, p[t]);
+                                sink_endexpr(out, "\n");
+                                first = false;
+                                continue;
+                        }
+
+                        sink_puts(out, "(imp (and");
+                        for (int s = 0; s < t; s++) {
+                                if (p[s] != s) fprint_equal(out, data, s, p[s]);
+                        }
+                        sink_puts(out, ") ");
+                        fprint_not_larger(out, data, t, p[t]);
+                        sink_endexpr(out, ")\n");
+                }
+        }
+}
+
+static int find_root (int *parent, int t)
+{
+        while (parent[t] != t) t = parent[t];
+        return t;
+}
+
+// (= v_a v_b) for clue cells cs[a] and cs[b] in step 0
+static void fprint_equal (sink_t *out, const data_t *data, int a, int b)
+{
+        const cell_t qa = data->cs[a];
+        const cell_t qb = data->cs[b];
+
+        sink_puts(out, " (or");
+        for (int n = 1; n <= data->size; n++) {
+                sink_puts(out, " (and");
+                fprint_literal(out, 'x', qa.I, qa.J, n, 0);
+                fprint_literal(out, 'x', qb.I, qb.J, n, 0);
+                sink_puts(out, ")");
+        }
+        sink_puts(out, ")");
+}
+
+// (<= v_a v_b): if v_b is n, then v_a is at most n.
+static void fprint_not_larger (sink_t *out, const data_t *data, int a, int b)
+{
+        const cell_t qa = data->cs[a];
+        const cell_t qb = data->cs[b];
+
+        sink_puts(out, "(and");
+        for (int n = 1; n < data->size; n++) {
+                sink_puts(out, " (imp");
+                fprint_literal(out, 'x', qb.I, qb.J, n, 0);
+                sink_puts(out, " (or");
+                for (int v = 1; v <= n; v++) {
+                        fprint_literal(out, 'x', qa.I, qa.J, v, 0);
+                }
+                sink_puts(out, "))");
+        }
+        sink_puts(out, ")");
+}
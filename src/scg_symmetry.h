@@ -0,0 +1,19 @@
+#ifndef SCG_SYMMETRY_H
+#define SCG_SYMMETRY_H
+
+#include "scg_modeler.h"
+
+// Automorphisms of the arrangement of clue cells: symmetries of the grid which map the clue cells onto themselves,
+// i.e., permutations of bands and of rows in each band, permutations of stacks and of columns in each stack,
+// and the transposition, together with which the rotations and reflections are obtained.
+// All constraints are the same under them, so that the numbers of clues of a model, moved by one of them,
+// are those of another model.
+//
+// find_automorphisms() is called by read_input(), and keeps generators of the automorphisms found
+// as permutations of the indices of clue cells. fprint_cons_for_lex_leader() allows only the models
+// whose numbers of clues in the order of cs are lexicographically not larger than those moved by any generator.
+// The least model in each orbit remains, also together with --symmetry, which is the same order on numbers.
+extern void find_automorphisms         (data_t *data);
+extern void fprint_cons_for_lex_leader (sink_t *out, data_t *data);
+
+#endif /*SCG_SYMMETRY_H*/
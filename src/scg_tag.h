@@ -15,6 +15,12 @@ typedef enum {
         tag_LC_A, // for parameter id of group A.
         tag_LC_B, // for parameter id of group B
         tag_LC_T, // for parameter id of the types of A and B
+        tag_AG,   // for aggregates over units (see scg_aggregate.h)
+        tag_AG_U, // for parameter id of the unit
+        tag_AG_T, // for parameter id of the position in the unit
+        tag_AG_D, // for parameter id of the kind of aggregates
+        tag_FS,   // for flags of final states (see scg_final.h)
+        tag_FS_D, // for parameter id of the kind of flags
 } stag_t;
 
 
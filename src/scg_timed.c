@@ -0,0 +1,580 @@
+#include <assert.h>
+#include <stdbool.h>
+
+#include "scg_timed.h"
+#include "scg_assert.h"
+
+static void fprint_name_of_t  (sink_t *out, int i, int j);
+static void fprint_name_of_v  (sink_t *out, int i, int j);
+static void fprint_name_of_e  (sink_t *out, int i, int j, int n);
+static void fprint_name_of_s  (sink_t *out, int i, int j, int n);
+static void fprint_name_of_l  (sink_t *out, int n, int type_AB, int group_A, int group_B);
+
+static void fprint_sr_time     (sink_t *out, const data_t *data, cell_t q, int n);
+static void fprint_lc_time     (sink_t *out, const data_t *data, cell_t q, int n);
+static void fprint_strat_time  (sink_t *out, const data_t *data, cell_t q, int n);
+static void fprint_delayed     (sink_t *out, const data_t *data);
+static void fprint_max_of_e    (sink_t *out, const lit_t *lits, int len);
+static void fprint_nested_open (sink_t *out, const char *op, int pos, int len);
+static void fprint_nested_close(sink_t *out, int len);
+
+static int  collect_unit      (const data_t *data, cell_t q, int n, char type, lit_t *lits);
+static int  collect_lc_cells  (const data_t *data, int n, int type_AB, int group_A, int group_B, lit_t *lits);
+
+// Times range from 0 to bound + 1, where bound + 1 means "never within the maximum step".
+//
+// t_i_j   : step at which a number is placed at (i,j), i.e., the least k such that x_i_j_k != 0.
+// v_i_j   : the number placed at (i,j), i.e., x_i_j_k = v_i_j for all k >= t_i_j.
+// e_i_j_n : step at which n is eliminated at (i,j), i.e., the least k such that y_i_j_n_k is false.
+// s_i_j_n : step at which some strategy places n at (i,j), only for non-clue cells.
+// l_n_T_A_B : step from which n is locked in A in the sense of Locked Candidates (see locked_candidates.c),
+//             i.e., the least k such that n is eliminated in all cells of B but not in A in step k.
+//
+// Only X variables in step 0 are declared, so that clues are decoded as in the other encodings.
+void fprint_decl_for_times (sink_t *out, data_t *data)
+{
+        sink_puts(out, ";\n");
+        sink_puts(out, "; Time Variables\n");
+
+        param_t *p = data->p;
+
+        const int size  = data->size;
+        const int rank  = data->rank;
+        const int never = data->bound + 1;
+
+        const int pid_I = data->pid_I;
+        const int pid_J = data->pid_J;
+
+        make_all_inactive(p);
+        make_IJ_active(p);
+
+        for(reset_param(p); p->end == false; next_param(p)) {
+                const cell_t q = cell_at(p->cur[pid_I], p->cur[pid_J], rank);
+
+                sink_puts(out, "(int ");
+                fprint_name_of_t(out, q.I, q.J);
+                sink_puts(out, " 0 ");
+                sink_putint(out, never);
+                sink_endexpr(out, ")\n");
+
+                sink_puts(out, "(int ");
+                fprint_name_of_v(out, q.I, q.J);
+                sink_puts(out, " 1 ");
+                sink_putint(out, size);
+                sink_endexpr(out, ")\n");
+
+                for (int n = 1; n <= size; n++) {
+                        sink_puts(out, "(int ");
+                        fprint_name_of_e(out, q.I, q.J, n);
+                        sink_puts(out, " 0 ");
+                        sink_putint(out, never);
+                        sink_endexpr(out, ")\n");
+                }
+
+                for (int c = first_case(out, data, q); c != CASE_NONE; c = next_case(out, data, q, c)) {
+                        if (c == CASE_CLUE) continue;
+
+                        for (int n = 1; n <= size; n++) {
+                                sink_puts(out, "(int ");
+                                fprint_name_of_s(out, q.I, q.J, n);
+                                sink_puts(out, " 0 ");
+                                sink_putint(out, never);
+                                sink_endexpr(out, ")\n");
+                        }
+                }
+        }
+
+        if (get_idmgr(tag_LC, data) == NULL) return;
+
+        for (int n = 1; n <= size; n++) {
+                for (int type_AB = TYPE_ARBB; type_AB <= TYPE_ABBC; type_AB++) {
+                        for (int group_A = 0; group_A < size; group_A++) {
+                                for (int group_B = 0; group_B < size; group_B++) {
+                                        if (false == have_common_cell(group_A, group_B, type_AB, rank)) continue;
+
+                                        sink_puts(out, "(int ");
+                                        fprint_name_of_l(out, n, type_AB, group_A, group_B);
+                                        sink_puts(out, " 0 ");
+                                        sink_putint(out, never);
+                                        sink_endexpr(out, ")\n");
+                                }
+                        }
+                }
+        }
+}
+
+// A clue cell is placed in step 0 with the value of x_i_j_0,
+// and its candidates are eliminated only by the Sudoku rule in step 0, because they are copied afterwards.
+//
+// For a non-clue cell (i,j) and a number n,
+// e_i_j_n = min(SR, LC + 1), where SR is the step at which the Sudoku rule applies (see fprint_sr_time())
+//                            and LC the step from which n is locked in another group (see fprint_lc_time()),
+// s_i_j_n = min(NS, HS_row, HS_column, HS_block) + 1, where
+//           NS     = max(e_i_j_m) over all m != n, and
+//           HS_row = max(e_i_l_n) over all cells (i,l) != (i,j) in the row, and so on,
+// t_i_j   = min(s_i_j_n) over all n, and v_i_j = n if s_i_j_n <= bound,
+// so that two different numbers are never placed at the same cell.
+// All +1 are bounded by bound + 1, in accordance with the transitions in steps 1, ..., bound.
+//
+// Finally, some number remains a candidate at each cell until the maximum step.
+void fprint_cons_for_times (sink_t *out, data_t *data)
+{
+        sink_puts(out, ";\n");
+        sink_puts(out, "; Constraints for Times\n");
+
+        param_t *p = data->p;
+
+        const int size  = data->size;
+        const int rank  = data->rank;
+        const int never = data->bound + 1;
+
+        const int pid_I = data->pid_I;
+        const int pid_J = data->pid_J;
+
+        if (get_idmgr(tag_LC, data) != NULL) {
+                lit_t lits[size];
+
+                for (int n = 1; n <= size; n++) {
+                        for (int type_AB = TYPE_ARBB; type_AB <= TYPE_ABBC; type_AB++) {
+                                for (int group_A = 0; group_A < size; group_A++) {
+                                        for (int group_B = 0; group_B < size; group_B++) {
+                                                if (false == have_common_cell(group_A, group_B, type_AB, rank)) continue;
+
+                                                const int len = collect_lc_cells(data, n, type_AB, group_A, group_B, lits);
+
+                                                sink_puts(out, "(= ");
+                                                fprint_name_of_l(out, n, type_AB, group_A, group_B);
+                                                sink_putc(out, ' ');
+                                                fprint_max_of_e(out, lits, len);
+                                                sink_endexpr(out, ")\n");
+                                        }
+                                }
+                        }
+                }
+        }
+
+        make_all_inactive(p);
+        make_IJ_active(p);
+
+        for(reset_param(p); p->end == false; next_param(p)) {
+                const cell_t q = cell_at(p->cur[pid_I], p->cur[pid_J], rank);
+
+                for (int c = first_case(out, data, q); c != CASE_NONE; c = next_case(out, data, q, c)) {
+                        if (c == CASE_CLUE) {
+                                sink_puts(out, "(= ");
+                                fprint_name_of_t(out, q.I, q.J);
+                                sink_endexpr(out, " 0)\n");
+
+                                sink_puts(out, "(= ");
+                                fprint_name_of_v(out, q.I, q.J);
+                                sink_putc(out, ' ');
+                                fprint_name_of_x(out, q.I, q.J, 0);
+                                sink_endexpr(out, ")\n");
+
+                                for (int n = 1; n <= size; n++) {
+                                        sink_puts(out, "(= ");
+                                        fprint_name_of_e(out, q.I, q.J, n);
+                                        sink_puts(out, " (if (= ");
+                                        fprint_sr_time(out, data, q, n);
+                                        sink_puts(out, " 0) 0 ");
+                                        sink_putint(out, never);
+                                        sink_endexpr(out, "))\n");
+                                }
+                                continue;
+                        }
+
+                        for (int n = 1; n <= size; n++) {
+                                sink_puts(out, "(= ");
+                                fprint_name_of_e(out, q.I, q.J, n);
+                                if (get_idmgr(tag_LC, data) != NULL) {
+                                        sink_puts(out, " (min ");
+                                        fprint_sr_time(out, data, q, n);
+                                        fprint_delayed(out, data);
+                                        fprint_lc_time(out, data, q, n);
+                                        sink_endexpr(out, "))))\n");
+                                } else {
+                                        sink_putc(out, ' ');
+                                        fprint_sr_time(out, data, q, n);
+                                        sink_endexpr(out, ")\n");
+                                }
+                        }
+
+                        for (int n = 1; n <= size; n++) {
+                                sink_puts(out, "(= ");
+                                fprint_name_of_s(out, q.I, q.J, n);
+                                fprint_strat_time(out, data, q, n);
+                                sink_endexpr(out, ")\n");
+
+                                sink_puts(out, "(imp (< ");
+                                fprint_name_of_s(out, q.I, q.J, n);
+                                sink_putc(out, ' ');
+                                sink_putint(out, never);
+                                sink_puts(out, ") (= ");
+                                fprint_name_of_v(out, q.I, q.J);
+                                sink_putc(out, ' ');
+                                sink_putint(out, n);
+                                sink_endexpr(out, "))\n");
+                        }
+
+                        sink_puts(out, "(= ");
+                        fprint_name_of_t(out, q.I, q.J);
+                        sink_putc(out, ' ');
+                        for (int n = 1; n <= size; n++) {
+                                fprint_nested_open(out, "min", n - 1, size);
+                                fprint_name_of_s(out, q.I, q.J, n);
+                                sink_putc(out, ' ');
+                        }
+                        fprint_nested_close(out, size);
+                        sink_endexpr(out, ")\n");
+                }
+
+                sink_puts(out, "(or ");
+                for (int n = 1; n <= size; n++) {
+                        sink_puts(out, " (= ");
+                        fprint_name_of_e(out, q.I, q.J, n);
+                        sink_putc(out, ' ');
+                        sink_putint(out, never);
+                        sink_puts(out, ")");
+                }
+                sink_endexpr(out, ")\n");
+        }
+}
+
+// The grid does not change between the maximum step and the previous one,
+// i.e., no candidate of non-clue cells is eliminated in the maximum step,
+// only if all cells are completed by then.
+//
+// This is equivalent to the constraints for final states of the other encodings (see fprint_cons_for_final()),
+// because once the grid does not change in some step, it never changes in the following steps.
+void fprint_cons_for_timed_final (sink_t *out, data_t *data)
+{
+        sink_puts(out, ";\n");
+        sink_puts(out, "; Constraints for Final States\n");
+
+        param_t *p = data->p;
+
+        const int bound = data->bound;
+
+        const int pid_I = data->pid_I;
+        const int pid_J = data->pid_J;
+        const int pid_N = data->pid_N;
+
+        if (bound == 0) return; // no transition
+
+        make_all_inactive(p);
+        make_IJN_active(p);
+
+        sink_puts(out, "(imp ");
+
+        sink_puts(out, "(and ");
+        for(reset_param(p); p->end == false; next_param(p)) {
+                const cell_t q = cell_at(p->cur[pid_I], p->cur[pid_J], data->rank);
+
+                for (int c = first_case(out, data, q); c != CASE_NONE; c = next_case(out, data, q, c)) {
+                        if (c == CASE_NONCLUE) {
+                                sink_puts(out, " (!= ");
+                                fprint_name_of_e(out, q.I, q.J, p->cur[pid_N]);
+                                sink_putc(out, ' ');
+                                sink_putint(out, bound);
+                                sink_puts(out, ") ");
+                        }
+                }
+        }
+        sink_puts(out, ") ");
+
+        make_all_inactive(p);
+        make_IJ_active(p);
+
+        sink_puts(out, "(and ");
+        for(reset_param(p); p->end == false; next_param(p)) {
+                const cell_t q = cell_at(p->cur[pid_I], p->cur[pid_J], data->rank);
+
+                for (int c = first_case(out, data, q); c != CASE_NONE; c = next_case(out, data, q, c)) {
+                        if (c == CASE_NONCLUE) {
+                                sink_puts(out, " (<= ");
+                                fprint_name_of_t(out, q.I, q.J);
+                                sink_putc(out, ' ');
+                                sink_putint(out, bound);
+                                sink_puts(out, ") ");
+                        }
+                }
+        }
+        sink_puts(out, ")");
+
+        sink_endexpr(out, ")\n");
+}
+
+// Print out the step at which the Sudoku rule eliminates n at q:
+// the minimum of t_q if v_q != n, and t_r over all cells r sharing a group with q if v_r = n.
+static void fprint_sr_time (sink_t *out, const data_t *data, cell_t q, int n)
+{
+        const int size  = data->size;
+        const int rank  = data->rank;
+        const int never = data->bound + 1;
+
+        cell_t peers[3 * size];
+        int len = 0;
+
+        for (int r = 0; r < size * size; r++) {
+                const cell_t q2 = cell_at(r / size, r % size, rank);
+                if (equal_cell(q, q2)) continue;
+
+                if (q.I == q2.I || q.J == q2.J || ownerblock(q, rank) == ownerblock(q2, rank)) {
+                        peers[len++] = q2;
+                }
+        }
+
+        fprint_nested_open(out, "min", 0, len + 1);
+        sink_puts(out, "(if (!= ");
+        fprint_name_of_v(out, q.I, q.J);
+        sink_putc(out, ' ');
+        sink_putint(out, n);
+        sink_puts(out, ") ");
+        fprint_name_of_t(out, q.I, q.J);
+        sink_putc(out, ' ');
+        sink_putint(out, never);
+        sink_puts(out, ") ");
+
+        for (int pos = 0; pos < len; pos++) {
+                fprint_nested_open(out, "min", pos + 1, len + 1);
+                sink_puts(out, "(if (= ");
+                fprint_name_of_v(out, peers[pos].I, peers[pos].J);
+                sink_putc(out, ' ');
+                sink_putint(out, n);
+                sink_puts(out, ") ");
+                fprint_name_of_t(out, peers[pos].I, peers[pos].J);
+                sink_putc(out, ' ');
+                sink_putint(out, never);
+                sink_puts(out, ") ");
+        }
+
+        fprint_nested_close(out, len + 1);
+}
+
+// Print out the minimum of l_n_T_A_B over all groups A and B such that q is in A but not in B.
+static void fprint_lc_time (sink_t *out, const data_t *data, cell_t q, int n)
+{
+        const int size  = data->size;
+        const int rank  = data->rank;
+
+        const char type_of_A[4] = {'r', 'c', 'b', 'b'}; // indexed by TYPE_ARBB, ..., TYPE_ABBC
+        const char type_of_B[4] = {'b', 'b', 'r', 'c'};
+
+        int ltype[4 * size], lA[4 * size], lB[4 * size];
+        int len = 0;
+
+        for (int type_AB = TYPE_ARBB; type_AB <= TYPE_ABBC; type_AB++) {
+                for (int group_A = 0; group_A < size; group_A++) {
+                        if (false == is_in_group(q, group_A, type_of_A[type_AB], rank)) continue;
+
+                        for (int group_B = 0; group_B < size; group_B++) {
+                                if (is_in_group(q, group_B, type_of_B[type_AB], rank))          continue;
+                                if (false == have_common_cell(group_A, group_B, type_AB, rank)) continue;
+
+                                ltype[len] = type_AB;
+                                lA[len]    = group_A;
+                                lB[len]    = group_B;
+                                len++;
+                        }
+                }
+        }
+
+        assert(len > 0);
+
+        for (int pos = 0; pos < len; pos++) {
+                fprint_nested_open(out, "min", pos, len);
+                fprint_name_of_l(out, n, ltype[pos], lA[pos], lB[pos]);
+                sink_putc(out, ' ');
+        }
+        fprint_nested_close(out, len);
+}
+
+// Print out s_i_j_n, the step at which Naked or Hidden Singles place n at q, or bound + 1 if they are disabled.
+static void fprint_strat_time (sink_t *out, const data_t *data, cell_t q, int n)
+{
+        const int size  = data->size;
+
+        const bool NS = (get_idmgr(tag_NS, data) != NULL);
+        const bool HS = (get_idmgr(tag_HS, data) != NULL);
+
+        if (false == NS && false == HS) {
+                sink_putc  (out, ' ');
+                sink_putint(out, data->bound + 1);
+                return;
+        }
+
+        const int nterms = (NS ? 1: 0) + (HS ? 3: 0);
+        int pos = 0;
+
+        lit_t lits[size];
+
+        fprint_delayed(out, data);
+
+        if (NS) {
+                int len = 0;
+                for (int m = 1; m <= size; m++) {
+                        if (m != n) lits[len++] = (lit_t){'y', q.I, q.J, m, 0};
+                }
+
+                fprint_nested_open(out, "min", pos++, nterms);
+                fprint_max_of_e(out, lits, len);
+        }
+
+        if (HS) {
+                const char types[3] = {'r', 'c', 'b'};
+                for (int t = 0; t < 3; t++) {
+                        const int len = collect_unit(data, q, n, types[t], lits);
+
+                        fprint_nested_open(out, "min", pos++, nterms);
+                        fprint_max_of_e(out, lits, len);
+                }
+        }
+
+        fprint_nested_close(out, nterms);
+        sink_puts(out, "))");
+}
+
+// Open "(min bound+1 (+ 1 ", where a term must follow and be closed by "))".
+static void fprint_delayed (sink_t *out, const data_t *data)
+{
+        sink_puts(out, " (min ");
+        sink_putint(out, data->bound + 1);
+        sink_puts(out, " (+ 1 ");
+}
+
+// Print out the maximum of e_i_j_n over all literals.
+static void fprint_max_of_e (sink_t *out, const lit_t *lits, int len)
+{
+        assert(len > 0);
+
+        for (int pos = 0; pos < len; pos++) {
+                fprint_nested_open(out, "max", pos, len);
+                fprint_name_of_e(out, lits[pos].I, lits[pos].J, lits[pos].N);
+                sink_putc(out, ' ');
+        }
+        fprint_nested_close(out, len);
+        sink_putc(out, ' ');
+}
+
+// Binary operators are nested to the right: (op a1 (op a2 ... (op a{len-1} a{len})...)),
+// where this is called before the pos-th argument, and fprint_nested_close() after the last one.
+static void fprint_nested_open (sink_t *out, const char *op, int pos, int len)
+{
+        if (pos + 1 < len) {
+                sink_putc(out, '(');
+                sink_puts(out, op);
+                sink_putc(out, ' ');
+        }
+}
+
+static void fprint_nested_close (sink_t *out, int len)
+{
+        for (int pos = 1; pos < len; pos++) {
+                sink_putc(out, ')');
+        }
+}
+
+// Collect the cells but q in the row, column, or block of q (see collect_literals()).
+static int collect_unit (const data_t *data, cell_t q, int n, char type, lit_t *lits)
+{
+        const int rank = data->rank;
+
+        runarg_t  runarg;
+        testarg_t testarg;
+        set_testarg(&testarg, q.I, q.J, -1, -1, rank);
+        set_runarg(&runarg,
+                q.I,
+                q.J,
+                n,
+                ownerblock(q, rank),
+                0,
+                type, 'y',
+                test_not_equal_cell, &testarg);
+
+        return collect_literals(data->p, &runarg, lits);
+}
+
+// Collect the cells in group B but not in group A (see locked_candidates.c).
+static int collect_lc_cells (const data_t *data, int n, int type_AB, int group_A, int group_B, lit_t *lits)
+{
+        const int rank = data->rank;
+
+        runarg_t  runarg;
+        testarg_t testarg;
+
+        switch (type_AB) {
+                case TYPE_ARBB:
+                        set_testarg(&testarg, group_A, -1, -1, -1, rank);
+                        set_runarg(&runarg, -1, -1, n, group_B, 0, 'b', 'y', test_not_in_row, &testarg);
+                        break;
+
+                case TYPE_ACBB:
+                        set_testarg(&testarg, -1, group_A, -1, -1, rank);
+                        set_runarg(&runarg, -1, -1, n, group_B, 0, 'b', 'y', test_not_in_column, &testarg);
+                        break;
+
+                case TYPE_ABBR:
+                        set_testarg(&testarg, -1, -1, -1, group_A, rank);
+                        set_runarg(&runarg, group_B, -1, n, -1, 0, 'r', 'y', test_not_in_block, &testarg);
+                        break;
+
+                case TYPE_ABBC:
+                        set_testarg(&testarg, -1, -1, -1, group_A, rank);
+                        set_runarg(&runarg, -1, group_B, n, -1, 0, 'c', 'y', test_not_in_block, &testarg);
+                        break;
+
+                default:
+                        assert(0);
+                        exit(EXIT_FAILURE);
+        }
+
+        return collect_literals(data->p, &runarg, lits);
+}
+
+static void fprint_name_of_t (sink_t *out, int i, int j)
+{
+        sink_puts(out, "t_");
+        sink_putint(out, i);
+        sink_putc(out, '_');
+        sink_putint(out, j);
+}
+
+static void fprint_name_of_v (sink_t *out, int i, int j)
+{
+        sink_puts(out, "v_");
+        sink_putint(out, i);
+        sink_putc(out, '_');
+        sink_putint(out, j);
+}
+
+static void fprint_name_of_e (sink_t *out, int i, int j, int n)
+{
+        sink_puts(out, "e_");
+        sink_putint(out, i);
+        sink_putc(out, '_');
+        sink_putint(out, j);
+        sink_putc(out, '_');
+        sink_putint(out, n);
+}
+
+static void fprint_name_of_s (sink_t *out, int i, int j, int n)
+{
+        sink_puts(out, "s_");
+        sink_putint(out, i);
+        sink_putc(out, '_');
+        sink_putint(out, j);
+        sink_putc(out, '_');
+        sink_putint(out, n);
+}
+
+static void fprint_name_of_l (sink_t *out, int n, int type_AB, int group_A, int group_B)
+{
+        sink_puts(out, "l_");
+        sink_putint(out, n);
+        sink_putc(out, '_');
+        sink_putint(out, type_AB);
+        sink_putc(out, '_');
+        sink_putint(out, group_A);
+        sink_putc(out, '_');
+        sink_putint(out, group_B);
+}
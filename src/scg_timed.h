@@ -0,0 +1,13 @@
+#ifndef SCG_TIMED_H
+#define SCG_TIMED_H
+
+#include "scg_modeler.h"
+
+// Step-free encoding (ENCODING_TIME): instead of copies of X and Y variables for all steps,
+// each cell has the step at which a number is placed, and each candidate the step at which it is eliminated.
+// Strategies are expressed by min and max of these times (see fprint_cons_for_times()).
+extern void fprint_decl_for_times      (sink_t *out, data_t *data);
+extern void fprint_cons_for_times      (sink_t *out, data_t *data);
+extern void fprint_cons_for_timed_final (sink_t *out, data_t *data);
+
+#endif /*SCG_TIMED_H*/
@@ -3,6 +3,7 @@
 #include "sudoku_rule.h"
 #include "scg_modeler.h"
 #include "scg_assert.h"
+#include "scg_reach.h"
 
 #define SR_NUM (0)
 #define SR_ROW (1)
@@ -12,18 +13,21 @@
 #define SR_MAX SR_BLK
 
 static bool accepted_SR_version (const int *buf, const data_t *data);
-static void fprint_cons_for_z_in_sudoku_rule (FILE *out, data_t *data);
-static void fprint_literals_for_y_in_sudoku_rule (FILE *out, const data_t *data);
+static void fprint_cons_for_z_in_sudoku_rule (sink_t *out, data_t *data);
+static void fprint_literals_for_y_in_sudoku_rule (sink_t *out, const data_t *data);
+static void set_runarg_of_kind (int kind, const data_t *data, runarg_t *runarg, testarg_t *testarg);
 
 void add_sudoku_rule (data_t *data)
 {
         param_t *p = data->p;
 
-        const int pid_SR = add_param(SR_MIN, SR_MAX, tag_SR, p);
+        const int max = (data->fused ? SR_MIN: SR_MAX); // fused variables have only the first kind.
+
+        const int pid_SR = add_param(SR_MIN, max, tag_SR, p);
         assert(pid_SR >= 0);
 
         int nvars = count_combinations_of_IJNK_values(p);
-        nvars = nvars * (SR_MAX - SR_MIN + 1);
+        nvars = nvars * (max - SR_MIN + 1);
         // NOTE: for simplicity, the strategy requests more variables than needed.
 	// The function accepted() decides whether variables really appear in constraints.
 
@@ -52,10 +56,12 @@ void add_sudoku_rule (data_t *data)
 // SR_COL: n is placed in another cell of the same column as (i,j) at k.
 // SR_BLK: n is placed in another cell of the same block  as (i,j) at k.
 //
-static void fprint_cons_for_z_in_sudoku_rule (FILE *out, data_t *data)
+// If fused, a single variable per (i,j,n,k) is defined by the disjunction of all of them.
+//
+static void fprint_cons_for_z_in_sudoku_rule (sink_t *out, data_t *data)
 {
-        fprintf(out, ";\n");
-        fprintf(out, "; Constraints for Sudoku Rule\n");
+        sink_puts(out, ";\n");
+        sink_puts(out, "; Constraints for Sudoku Rule\n");
 
         param_t *p = data->p;
         const int rank = data->rank;
@@ -79,69 +85,8 @@ static void fprint_cons_for_z_in_sudoku_rule (FILE *out, data_t *data)
 
         for(reset_param(p); p->end == false; next_param(p)) {
 
-                runarg_t  runarg;
-                testarg_t testarg;
-
-                switch (p->cur[pid_SR]) {
-                        case SR_NUM:
-                                set_testarg(&testarg, -1, -1, p->cur[pid_N], -1, rank);
-                                set_runarg(&runarg,
-                                        p->cur[pid_I],
-                                        p->cur[pid_J],
-                                        -1,
-                                        -1,
-                                        p->cur[pid_K],
-                                        'v', 'x',
-                                        test_not_equal_number, &testarg);
-                                break;
-
-                        case SR_ROW:
-                                set_testarg(&testarg, p->cur[pid_I], p->cur[pid_J], -1, -1, rank);
-                                set_runarg(&runarg,
-                                        p->cur[pid_I],
-                                        -1,
-                                        p->cur[pid_N],
-                                        -1,
-                                        p->cur[pid_K],
-                                        'r', 'x',
-                                        test_not_equal_cell, &testarg);
-                                break;
-
-                        case SR_COL:
-                                set_testarg(&testarg, p->cur[pid_I], p->cur[pid_J], -1, -1, rank);
-                                set_runarg(&runarg,
-                                        -1,
-                                        p->cur[pid_J],
-                                        p->cur[pid_N],
-                                        -1,
-                                        p->cur[pid_K],
-                                        'c', 'x',
-                                        test_not_equal_cell, &testarg);
-                                break;
-
-                        case SR_BLK:
-                                {
-                                set_testarg(&testarg, p->cur[pid_I], p->cur[pid_J], -1, -1, rank);
-
-                                cell_t q = cell_at(p->cur[pid_I], p->cur[pid_J], rank);
-                                const int group_B = ownerblock(q, rank);
-
-                                set_runarg(&runarg,
-                                        -1,
-                                        -1,
-                                        p->cur[pid_N],
-                                        group_B,
-                                        p->cur[pid_K],
-                                        'b', 'x',
-                                        test_not_equal_cell, &testarg);
-                                }
-                                break;
-
-                        default:
-                                assert(0);
-                                exit(EXIT_FAILURE);
-                }
-
+                runarg_t  runarg[SR_MAX - SR_MIN + 1];
+                testarg_t testarg[SR_MAX - SR_MIN + 1];
 
                 read_cur(p, buf, mgr);
 
@@ -150,25 +95,39 @@ static void fprint_cons_for_z_in_sudoku_rule (FILE *out, data_t *data)
                         mgr->encoder(buf, &index, rank, p, mgr);
                         assert_variable_index(index, mgr);
 
-                        fprintf(out, "(iff  z_%d ", index);
-                        fprint_clause (out, p, &runarg);
-                        fprintf(out, " )\n");
-
+                        if (data->fused) {
+                                for (int kind = SR_MIN; kind <= SR_MAX; kind++) {
+                                        set_runarg_of_kind(kind, data, &runarg[kind - SR_MIN], &testarg[kind - SR_MIN]);
+                                }
+                                fprint_definition_by_clauses(out, data, index, runarg, SR_MAX - SR_MIN + 1);
+                        } else {
+                                set_runarg_of_kind(p->cur[pid_SR], data, &runarg[0], &testarg[0]);
+                                fprint_definition_by_clause(out, data, index, &runarg[0]);
+                        }
                 }
         }
 
         make_all_inactive(p);
         make_IJK_active(p);
         for(reset_param(p); p->end == false; next_param(p)) {
-          fprintf(out, "(or  ");
-	        for (int n = p->min[pid_N]; n <= p->max[pid_N]; n++) {
-            fprintf(out, " y_%d_%d_%d_%d ", 
-			                        p->cur[pid_I], 
-                              p->cur[pid_J], 
-                              n, 
-                              p->cur[pid_K]);
-          }
-          fprintf(out, " )\n");
+                const cell_t q = cell_at(p->cur[pid_I], p->cur[pid_J], rank);
+
+                for (int c = first_case(out, data, q); c != CASE_NONE; c = next_case(out, data, q, c)) {
+                        // clue cells keep their step-0 candidates (see fprint_name_of_y()).
+                        if (c == CASE_CLUE && p->cur[pid_K] != p->min[pid_K]) continue;
+
+                        sink_puts(out, "(or  ");
+                        for (int n = p->min[pid_N]; n <= p->max[pid_N]; n++) {
+                                sink_putc(out, ' ');
+                                fprint_name_of_y(out,
+                                                 p->cur[pid_I],
+                                                 p->cur[pid_J],
+                                                 n,
+                                                 p->cur[pid_K]);
+                                sink_putc(out, ' ');
+                        }
+                        sink_endexpr(out, " )\n");
+                }
         }
 
 
@@ -183,7 +142,7 @@ static void fprint_cons_for_z_in_sudoku_rule (FILE *out, data_t *data)
 
 // Note: this function is supposed to be called within parameter loop.
 // In order not to change parameter values, declare const for param_t*.
-static void fprint_literals_for_y_in_sudoku_rule (FILE *out, const data_t *data)
+static void fprint_literals_for_y_in_sudoku_rule (sink_t *out, const data_t *data)
 {
         const param_t *p   = data->p;
         assert_IJNK_active(p);
@@ -217,7 +176,7 @@ static void fprint_literals_for_y_in_sudoku_rule (FILE *out, const data_t *data)
                         mgr->encoder(buf, &index, data->rank, p, mgr);
                         assert_variable_index(index, mgr);
 
-                        fprintf(out, " z_%d ", index);
+                        fprint_z_literal(out, index);
                 }
         }
 }
@@ -237,6 +196,83 @@ static bool accepted_SR_version (const int *buf, const data_t *data)
         const idmgr_t *mgr = get_idmgr(tag_SR, data);
         assert(mgr != NULL);
 
+        if (false == reachable(buf, mgr, data, false)) return false; // no placement eliminates the candidate yet.
+
+        const int pos_K = pos_of_pid(data->pid_K, mgr);
+        assert(0 <= pos_K);
+        if (false == applies_in_step(data, tag_SR, buf[pos_K])) return false;
+
         return accepted_general(buf, mgr, data);
 }
 
+// Set the run of literals of the condition of the kind for the current (i,j,n,k).
+static void set_runarg_of_kind (int kind, const data_t *data, runarg_t *runarg, testarg_t *testarg)
+{
+        const param_t *p = data->p;
+
+        const int rank  = data->rank;
+        const int pid_I = data->pid_I;
+        const int pid_J = data->pid_J;
+        const int pid_N = data->pid_N;
+        const int pid_K = data->pid_K;
+
+        switch (kind) {
+                case SR_NUM:
+                        set_testarg(testarg, -1, -1, p->cur[pid_N], -1, rank);
+                        set_runarg(runarg,
+                                p->cur[pid_I],
+                                p->cur[pid_J],
+                                -1,
+                                -1,
+                                p->cur[pid_K],
+                                'v', 'x',
+                                test_not_equal_number, testarg);
+                        break;
+
+                case SR_ROW:
+                        set_testarg(testarg, p->cur[pid_I], p->cur[pid_J], -1, -1, rank);
+                        set_runarg(runarg,
+                                p->cur[pid_I],
+                                -1,
+                                p->cur[pid_N],
+                                -1,
+                                p->cur[pid_K],
+                                'r', 'x',
+                                test_not_equal_cell, testarg);
+                        break;
+
+                case SR_COL:
+                        set_testarg(testarg, p->cur[pid_I], p->cur[pid_J], -1, -1, rank);
+                        set_runarg(runarg,
+                                -1,
+                                p->cur[pid_J],
+                                p->cur[pid_N],
+                                -1,
+                                p->cur[pid_K],
+                                'c', 'x',
+                                test_not_equal_cell, testarg);
+                        break;
+
+                case SR_BLK:
+                        {
+                        set_testarg(testarg, p->cur[pid_I], p->cur[pid_J], -1, -1, rank);
+
+                        cell_t q = cell_at(p->cur[pid_I], p->cur[pid_J], rank);
+                        const int group_B = ownerblock(q, rank);
+
+                        set_runarg(runarg,
+                                -1,
+                                -1,
+                                p->cur[pid_N],
+                                group_B,
+                                p->cur[pid_K],
+                                'b', 'x',
+                                test_not_equal_cell, testarg);
+                        }
+                        break;
+
+                default:
+                        assert(0);
+                        exit(EXIT_FAILURE);
+        }
+}
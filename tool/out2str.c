@@ -1,12 +1,29 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
 #include <assert.h>
 
+static int decode_with_names(const char *map_file, const char *out_file);
+static int decode_with_cnf(const char *cnf_file, const char *out_file);
+
 int main(int argc, char* argv[]) {
+  if (argc == 4 && strcmp(argv[1], "-m") == 0) {
+    return decode_with_names(argv[2], argv[3]);
+  }
+
+  if (argc == 4 && strcmp(argv[1], "-c") == 0) {
+    return decode_with_cnf(argv[2], argv[3]);
+  }
+
   if (argc != 3) {
     fprintf(stderr, "Usage: out2str rank sugar.out\n");
+    fprintf(stderr, "       out2str -m names.map sugar.log\n");
+    fprintf(stderr, "       out2str -c in.cnf sat.log\n");
     fprintf(stderr, "rank   2 for 4x4 grid, 3 for 9x9 grid, etc\n");
+    fprintf(stderr, "-m     read the whole output of Sugar for constraints generated with --compact-names\n");
+    fprintf(stderr, "-c     read the output of a SAT solver for constraints generated with --format cnf\n");
     fprintf(stderr, "\n");
     fprintf(stderr, "Example:\n");
     fprintf(stderr, "From the output of Sugar, this program makes the string of the initial grid.\n");
@@ -21,6 +38,18 @@ int main(int argc, char* argv[]) {
     fprintf(stderr, "out2str 2 sugar.out\n");
     fprintf(stderr, "0010003030002000\n");
     fprintf(stderr, "\n");
+    fprintf(stderr, "With compact names, the output of Sugar is read as it is:\n");
+    fprintf(stderr, "scg_modeler -N -H -L -r 2 -k 10 --compact-names names.map r2/r2c4-997 > in.csp\n");
+    fprintf(stderr, "sugar in.csp > tmp\n");
+    fprintf(stderr, "out2str -m names.map tmp\n");
+    fprintf(stderr, "0010003030002000\n");
+    fprintf(stderr, "\n");
+    fprintf(stderr, "In the CNF format, the map of variables is read from the comments of in.cnf:\n");
+    fprintf(stderr, "scg_modeler -N -H -L -r 2 -k 10 --format cnf r2/r2c4-997 > in.cnf\n");
+    fprintf(stderr, "minisat in.cnf tmp\n");
+    fprintf(stderr, "out2str -c in.cnf tmp\n");
+    fprintf(stderr, "0010003030002000\n");
+    fprintf(stderr, "\n");
     fprintf(stderr, "[Author] Takahisa Toda <todat@acm.org>\n");
     fprintf(stderr, "Graduate School of Information Systems, the University of Electro-Communications\n");
     fprintf(stderr, "1-5-1 Chofugaoka, Chofu, Tokyo 182-8585, Japan\n");
@@ -80,3 +109,182 @@ int main(int argc, char* argv[]) {
 
   return 0;
 }
+
+// Read the map of compact names written by scg_modeler --compact-names,
+// and print out the initial grid from lines "a x<id> n" in the output of Sugar.
+// Only X variables are decoded (see fwrite_names() in scg_modeler.c for the format).
+static int decode_with_names(const char *map_file, const char *out_file) {
+  FILE *map = fopen(map_file, "rb");
+  if (map == NULL) {
+    fprintf(stderr, "Error: cannot open %s\n", map_file);
+    exit(EXIT_FAILURE);
+  }
+
+  char magic[4];
+  int32_t head[6]; // version rank bound nx ny nz
+  if (fread(magic, 1, 4, map) != 4 || memcmp(magic, "SCGN", 4) != 0
+   || fread(head, sizeof(int32_t), 6, map) != 6 || head[0] != 1) {
+    fprintf(stderr, "ERROR: %s is not a map of compact names.\n", map_file);
+    exit(EXIT_FAILURE);
+  }
+
+  const int rank = head[1];
+  const int size = rank * rank;
+  const int nx   = head[3];
+
+  int32_t *xs = (int32_t*)malloc(sizeof(int32_t) * 3 * nx); // (i, j, k) of x<id>
+  if (xs == NULL) {
+    fprintf(stderr, "ERROR: Memory allocation failed.\n");
+    exit(EXIT_FAILURE);
+  }
+  if (fread(xs, sizeof(int32_t), 3 * nx, map) != (size_t)(3 * nx)) {
+    fprintf(stderr, "ERROR: %s is truncated.\n", map_file);
+    exit(EXIT_FAILURE);
+  }
+  fclose(map);
+
+  FILE *in = fopen(out_file, "r");
+  if (in == NULL) {
+    fprintf(stderr, "Error: cannot open %s\n", out_file);
+    exit(EXIT_FAILURE);
+  }
+
+  int *grid = (int*)malloc(sizeof(int) * size * size);
+  if (grid == NULL) {
+    fprintf(stderr, "ERROR: Memory allocation failed.\n");
+    exit(EXIT_FAILURE);
+  }
+  for (int k = 0; k < size * size; k++) {
+    grid[k] = 0;
+  }
+
+  char line[BUFSIZ];
+  while (fgets(line, sizeof(line), in) != NULL) {
+    int id, n;
+    if (sscanf(line, "a x%d %d", &id, &n) != 2) continue;
+
+    if (id < 0 || nx <= id || n < 0 || size < n) {
+      fprintf(stderr, "ERROR: Invalid assignment: %s", line);
+      exit(EXIT_FAILURE);
+    }
+
+    if (xs[3 * id + 2] == 0) { // step 0
+      grid[xs[3 * id] * size + xs[3 * id + 1]] = n;
+    }
+  }
+
+  for (int k = 0; k < size * size; k++) {
+    fprintf(stdout, "%d", grid[k]);
+  }
+  fprintf(stdout, "\n");
+
+  fclose(in);
+  free(xs);
+  free(grid);
+
+  return 0;
+}
+
+// Read the map of variables in the comments "c x_i_j_0 n v" of a CNF written by scg_modeler --format cnf,
+// and print out the initial grid from the model of a SAT solver.
+// Both "v lit ..." lines of SAT competitions and the plain list of literals of minisat are read.
+static int decode_with_cnf(const char *cnf_file, const char *out_file) {
+  FILE *cnf = fopen(cnf_file, "r");
+  if (cnf == NULL) {
+    fprintf(stderr, "Error: cannot open %s\n", cnf_file);
+    exit(EXIT_FAILURE);
+  }
+
+  int rank = 0;
+  int nmap = 0;   // number of entries of the map
+  int cap  = BUFSIZ;
+  int32_t *map = (int32_t*)malloc(sizeof(int32_t) * 4 * cap); // (v, i, j, n)
+  if (map == NULL) {
+    fprintf(stderr, "ERROR: Memory allocation failed.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  char line[BUFSIZ];
+  while (fgets(line, sizeof(line), cnf) != NULL && line[0] != 'p') {
+    int i, j, n, v;
+    if (sscanf(line, "c map rank %d", &rank) == 1) continue;
+    if (sscanf(line, "c x_%d_%d_0 %d %d", &i, &j, &n, &v) != 4) continue;
+
+    if (nmap == cap) {
+      cap = cap * 2;
+      map = (int32_t*)realloc(map, sizeof(int32_t) * 4 * cap);
+      if (map == NULL) {
+        fprintf(stderr, "ERROR: Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+      }
+    }
+    map[4 * nmap]     = v;
+    map[4 * nmap + 1] = i;
+    map[4 * nmap + 2] = j;
+    map[4 * nmap + 3] = n;
+    nmap++;
+  }
+  fclose(cnf);
+
+  const int size = rank * rank;
+  if (rank < 2) {
+    fprintf(stderr, "ERROR: %s has no map of variables.\n", cnf_file);
+    exit(EXIT_FAILURE);
+  }
+
+  int maxvar = 0;
+  for (int pos = 0; pos < nmap; pos++) {
+    if (map[4 * pos] > maxvar) maxvar = map[4 * pos];
+  }
+  int *entry = (int*)malloc(sizeof(int) * (maxvar + 1));
+  int *grid  = (int*)malloc(sizeof(int) * size * size);
+  if (entry == NULL || grid == NULL) {
+    fprintf(stderr, "ERROR: Memory allocation failed.\n");
+    exit(EXIT_FAILURE);
+  }
+  for (int v = 0; v <= maxvar; v++) {
+    entry[v] = -1;
+  }
+  for (int pos = 0; pos < nmap; pos++) {
+    entry[map[4 * pos]] = pos;
+  }
+  for (int k = 0; k < size * size; k++) {
+    grid[k] = 0;
+  }
+
+  FILE *in = fopen(out_file, "r");
+  if (in == NULL) {
+    fprintf(stderr, "Error: cannot open %s\n", out_file);
+    exit(EXIT_FAILURE);
+  }
+
+  // literals are read token by token, since lines of models may be very long.
+  char tok[64];
+  while (fscanf(in, "%63s", tok) == 1) {
+    char *end;
+    const long lit = strtol(tok, &end, 10);
+    if (*end != '\0' || lit <= 0 || maxvar < lit) continue;
+
+    const int pos = entry[lit];
+    if (pos < 0) continue;
+
+    if (map[4 * pos + 1] < 0 || size <= map[4 * pos + 1]
+     || map[4 * pos + 2] < 0 || size <= map[4 * pos + 2]) {
+      fprintf(stderr, "ERROR: Invalid map of variables in %s\n", cnf_file);
+      exit(EXIT_FAILURE);
+    }
+    grid[map[4 * pos + 1] * size + map[4 * pos + 2]] = map[4 * pos + 3];
+  }
+
+  for (int k = 0; k < size * size; k++) {
+    fprintf(stdout, "%d", grid[k]);
+  }
+  fprintf(stdout, "\n");
+
+  fclose(in);
+  free(map);
+  free(entry);
+  free(grid);
+
+  return 0;
+}